@@ -3,6 +3,8 @@
 
 #include <singleton.h>
 
+#include <string_view>
+
 // #include <iostream>
 
 namespace es::init {
@@ -20,6 +22,19 @@ public:
     {
         for (auto ii = 0; ii < app_argc; ++ii) f(ii, app_argv[ii]);
     }
+
+    // value of the command line option --name=value or --name value, nullptr if not given.
+    const char* option(std::string_view name) const
+    {
+        for (auto ii = 1; ii < app_argc; ++ii)
+        {
+            std::string_view a{app_argv[ii]};
+            if (a.size() < name.size() + 2 || a.substr(0, 2) != "--" || a.substr(2, name.size()) != name) continue;
+            if (a.size() == name.size() + 2) return ii + 1 < app_argc ? app_argv[ii + 1] : nullptr;
+            if (a[name.size() + 2] == '=') return app_argv[ii] + name.size() + 3;
+        }
+        return nullptr;
+    }
 };
 
 [[using gnu: used]] static inline auto& args{singleton<app_args, early_initializer>::instance()};
@@ -5,6 +5,7 @@
 #include <unistd.h>  // extern "C" char **environ;
 
 #include <iostream>
+#include <string_view>
 
 namespace es::init {
 
@@ -30,6 +31,18 @@ public:
     {
         for (auto ii = 0; ::environ[ii]; ++ii) f(ii, ::environ[ii]);
     }
+
+    // value of the environment variable name, nullptr if not set.
+    const char* get(std::string_view name) const
+    {
+        for (auto ii = 0; ::environ[ii]; ++ii)
+        {
+            std::string_view e{::environ[ii]};
+            if (e.size() > name.size() && e[name.size()] == '=' && e.substr(0, name.size()) == name)
+                return ::environ[ii] + name.size() + 1;
+        }
+        return nullptr;
+    }
 };
 
 [[using gnu: used]] static inline auto& env{singleton<app_env, early_initializer>::instance()};
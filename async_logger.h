@@ -0,0 +1,262 @@
+//
+// async_logger - lock-free, multi producer, single consumer logger singleton, constructed first and destroyed last.
+//
+// Producers copy a formatted line into a slot of a bounded ring (no lock, no system call on the hot path), a
+// background thread writes the lines in batches to the output sink, write(2) to stderr by default.
+//
+// es::init::log() << "order " << id << " filled: " << qty;
+//
+// The logger singleton is created by a priority constructor, before ordered_init<> and the early_initializer(s), so
+// it is the first node of the destruction stack - it is destroyed after all the other singletons, and it drains the
+// ring before its thread exits. Singletons may log from their constructors and destructors, nothing is lost.
+// While it is alive, it is also the library's diagnostics sink.
+//
+// A full ring blocks the producers until the thread catches up. Before the logger is constructed and after it is
+// destroyed, log() writes synchronously. In a forked child the parent's logger is dropped first, by its fork child
+// hook, and the logger is constructed again (reinit_in_child), after the inherited singletons, so their destructors log
+// synchronously.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <linux/futex.h>
+#include <singleton.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace es::init {
+
+class async_logger
+{
+public:
+    static constexpr std::size_t slot_size{512};  // a longer line is truncated, its '\n' kept
+    static constexpr std::size_t slots{512};      // power of 2
+    static_assert((slots & (slots - 1)) == 0, "slots should be a power of 2");
+
+    async_logger()
+    {
+        for (std::size_t i = 0; i < slots; ++i) _ring[i]._seq.store(i, std::memory_order_relaxed);
+        _thread = std::thread{[this] { run(); }};
+        active_logger.store(this);
+        auto previous              = set_diagnostics_sink(sink);
+        _previous_diagnostics_sink = previous == sink ? nullptr : previous;
+        if (auto hook = set_fork_child_hook(fork_child); hook != fork_child) previous_fork_child_hook = hook;
+    }
+
+    ~async_logger()
+    {
+        set_diagnostics_sink(_previous_diagnostics_sink);
+        active_logger.store(nullptr);
+        _stop.store(true);
+        wake();
+        _thread.join();  // the thread drains the ring before it exits
+    }
+
+    async_logger(const async_logger&) = delete;
+    async_logger& operator=(const async_logger&) = delete;
+
+    // copies one line, including its '\n', into the ring. A truncated line still ends with '\n', the batches join slots.
+    void write(const char* line, std::size_t length) noexcept
+    {
+        const bool truncated{length > sizeof(slot::_text)};
+        if (truncated) length = sizeof(slot::_text);
+
+        uint64_t pos{_tail.load(std::memory_order_relaxed)};
+        slot*    s;
+        for (;;)
+        {
+            s = &_ring[pos & (slots - 1)];
+            int64_t diff{static_cast<int64_t>(s->_seq.load(std::memory_order_acquire) - pos)};
+            if (diff == 0)
+            {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)  // full
+            {
+                wake();
+                std::this_thread::yield();
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+            else
+                pos = _tail.load(std::memory_order_relaxed);
+        }
+        std::memcpy(s->_text, line, length);
+        if (truncated) s->_text[length - 1] = '\n';
+        s->_length = static_cast<uint32_t>(length);
+        s->_seq.store(pos + 1, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleeping.load(std::memory_order_relaxed)) wake();
+    }
+
+    // waits until all the lines written before the call are passed to the output sink.
+    void flush() noexcept
+    {
+        const uint64_t target{_tail.load()};
+        while (_written.load(std::memory_order_acquire) < target)
+        {
+            wake();
+            std::this_thread::yield();
+        }
+    }
+
+    // the sink receives one or more complete lines, from the logger's thread. nullptr - write(2) to stderr.
+    void set_output(diagnostics_sink_t output) noexcept { _output.store(output); }
+
+    // the constructed logger, nullptr before its construction and during its destruction.
+    static async_logger* active() noexcept { return active_logger.load(std::memory_order_acquire); }
+
+    // diagnostics_sink_t, to the logger while it is alive, synchronously to stderr otherwise.
+    static void sink(const char* line, std::size_t length)
+    {
+        if (auto logger = active())
+            logger->write(line, length);
+        else
+            stderr_diagnostics_sink(line, length);
+    }
+
+private:
+    struct alignas(64) slot
+    {
+        std::atomic<uint64_t> _seq;  // == position: free, == position + 1: holds a line
+        uint32_t              _length;
+        char                  _text[slot_size - sizeof(std::atomic<uint64_t>) - sizeof(uint32_t)];
+    };
+    static_assert(sizeof(slot) == slot_size, "slot should fill its slot_size");
+
+    void run()
+    {
+        char batch[16 * 1024];
+        for (;;)
+        {
+            const bool  stop{_stop.load()};
+            std::size_t n{0};
+            uint64_t    drained{_head};
+            for (;;)
+            {
+                slot& s{_ring[_head & (slots - 1)]};
+                if (s._seq.load(std::memory_order_acquire) != _head + 1) break;
+                if (n + s._length > sizeof(batch))
+                {
+                    write_output(batch, n);
+                    n = 0;
+                }
+                std::memcpy(batch + n, s._text, s._length);
+                n += s._length;
+                s._seq.store(_head + slots, std::memory_order_release);
+                ++_head;
+            }
+            if (n) write_output(batch, n);
+            _written.store(_head, std::memory_order_release);
+            if (_head != drained) continue;
+            if (stop) return;  // the ring was empty after the stop request
+            sleep();
+        }
+    }
+
+    void write_output(const char* lines, std::size_t length)
+    {
+        auto out = _output.load();
+        (out ? out : stderr_diagnostics_sink)(lines, length);
+    }
+
+    // futex sleep, bounded by a timeout - a missed wake up only delays the output.
+    void sleep() noexcept
+    {
+        _sleeping.store(1);
+        slot& s{_ring[_head & (slots - 1)]};
+        if (s._seq.load() != _head + 1 && !_stop.load())
+        {
+            timespec timeout{0, 50'000'000};
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_sleeping), FUTEX_WAIT_PRIVATE, 1, &timeout, nullptr, 0);
+        }
+        _sleeping.store(0);
+    }
+
+    void wake() noexcept
+    {
+        if (_sleeping.exchange(0))
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_sleeping), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // the parent's logger, and its thread, do not exist in the child - log() writes synchronously until reinit_in_child
+    // constructs the child's logger.
+    static void fork_child() noexcept
+    {
+        active_logger.store(nullptr);
+        if (previous_fork_child_hook) previous_fork_child_hook();
+    }
+
+    inline static std::atomic<async_logger*> active_logger;  // do NOT initialize, default nullptr
+    inline static fork_child_hook_t          previous_fork_child_hook;  // do NOT initialize, default nullptr
+
+    alignas(64) std::atomic<uint64_t> _tail{0};  // producers
+    alignas(64) uint64_t _head{0};               // the logger's thread
+    std::atomic<uint64_t> _written{0};
+    std::atomic<uint32_t> _sleeping{0};
+    std::atomic<bool>     _stop{false};
+    alignas(64) std::atomic<diagnostics_sink_t> _output{nullptr};
+    diagnostics_sink_t _previous_diagnostics_sink{nullptr};
+    std::thread        _thread;
+    slot               _ring[slots];
+};
+
+// the parent's thread does not exist in the child.
+template<>
+struct fork_policy_traits<async_logger>
+{
+    static constexpr fork_policy value{fork_policy::reinit_in_child};
+};
+
+// before ordered_init<> (200) and the early_initializer(s) (default priority), 101 is the first non reserved priority.
+// GCC ignores the priority of early_init(), a template's member, construct_logger() applies it.
+template<typename T>
+struct logger_initializer
+{
+    [[using gnu: used, constructor(101)]] static void early_init() { T::instance(); }
+};
+
+using logger = singleton<async_logger, logger_initializer>;
+static_assert(sizeof(logger) != 0, "instantiates logger_initializer<logger>::early_init()");
+
+[[using gnu: used, constructor(101)]] inline void construct_logger()
+{
+    logger::instance();
+}
+
+// one line, queued to the logger when the statement ends.
+inline diagnostic log() noexcept
+{
+    return diagnostic{async_logger::sink};
+}
+
+}  // namespace es::init
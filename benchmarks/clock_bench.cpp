@@ -0,0 +1,45 @@
+//
+// Timestamp cost - es::init::tsc_clock::now_ns() vs its clock_gettime() fall back and std::chrono::steady_clock.
+//
+//   build/clock_bench [iterations]
+//
+
+#include <tsc_clock.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+template<typename F>
+static void measure(const char* name, long iterations, F&& f)
+{
+    int64_t sink{0};
+    auto    start{std::chrono::steady_clock::now()};
+    for (long i = 0; i < iterations; ++i) sink += f();
+    auto end{std::chrono::steady_clock::now()};
+    asm volatile("" : : "r"(sink));
+
+    double ns{std::chrono::duration<double, std::nano>(end - start).count()};
+    printf("%-32s %8.2f ns/call\n", name, ns / iterations);
+}
+
+int main(int argc, char** argv)
+{
+    long iterations{argc > 1 ? atol(argv[1]) : 10'000'000L};
+
+    auto&                      clock{es::init::tsc_clock_singleton::instance()};
+    const es::init::tsc_clock fallback{false};
+
+    printf("invariant tsc: %s, ticks per second: %lu, iterations: %ld\n", clock.uses_tsc() ? "yes" : "no",
+           static_cast<unsigned long>(clock.ticks_per_second()), iterations);
+
+    measure("tsc_clock::now_ns()", iterations, [&]() { return clock.now_ns(); });
+    measure("tsc_clock::now_ns() fall back", iterations, [&]() { return fallback.now_ns(); });
+    measure("clock_gettime(CLOCK_MONOTONIC)", iterations, []() { return es::init::monotonic_ns(); });
+    measure("std::chrono::steady_clock::now()", iterations,
+            []() { return std::chrono::steady_clock::now().time_since_epoch().count(); });
+
+    int64_t tsc_ns{clock.now_ns()}, mono_ns{es::init::monotonic_ns()};
+    printf("now_ns() - clock_gettime(): %ld ns\n", static_cast<long>(tsc_ns - mono_ns));
+    return 0;
+}
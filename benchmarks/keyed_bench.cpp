@@ -0,0 +1,101 @@
+//
+// Per key instance lookup - es::init::keyed_singleton<T, Key>::instance(key) vs a singleton map behind a mutex.
+//
+//   build/keyed_bench [iterations] [keys] [threads]
+//
+
+#include <keyed_singleton.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Venue
+{
+    explicit Venue(int id) : _id(id) {}
+    int _id;
+};
+
+template<typename Mutex>
+struct venue_map
+{
+    Venue& get(int key)
+    {
+        std::lock_guard<Mutex> guard(_mutex);
+        auto&                  p{_venues[key]};
+        if (!p) p = std::make_unique<Venue>(key);
+        return *p;
+    }
+    Mutex                                           _mutex;
+    std::unordered_map<int, std::unique_ptr<Venue>> _venues;
+};
+
+// readers share the lock, the first access of a key takes it exclusively.
+struct shared_venue_map
+{
+    Venue& get(int key)
+    {
+        {
+            std::shared_lock<std::shared_mutex> guard(_mutex);
+            auto                                it{_venues.find(key)};
+            if (it != _venues.end()) return *it->second;
+        }
+        std::unique_lock<std::shared_mutex> guard(_mutex);
+        auto&                               p{_venues[key]};
+        if (!p) p = std::make_unique<Venue>(key);
+        return *p;
+    }
+    std::shared_mutex                               _mutex;
+    std::unordered_map<int, std::unique_ptr<Venue>> _venues;
+};
+
+template<typename F>
+static void measure(const char* name, long iterations, int keys, int threads, F&& f)
+{
+    std::vector<std::thread> workers;
+    auto                     start{std::chrono::steady_clock::now()};
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]() {
+            long sink{0};
+            int  key{t};
+            for (long i = 0; i < iterations; ++i)
+            {
+                sink += f(key)._id;
+                key = (key + 7) % keys;
+            }
+            asm volatile("" : : "r"(sink));
+        });
+    for (auto& w : workers) w.join();
+    auto end{std::chrono::steady_clock::now()};
+
+    double ns{std::chrono::duration<double, std::nano>(end - start).count()};
+    printf("%-40s %8.2f ns/call\n", name, ns / (double(iterations) * threads));
+}
+
+int main(int argc, char** argv)
+{
+    long iterations{argc > 1 ? atol(argv[1]) : 10'000'000L};
+    int  keys{argc > 2 ? atoi(argv[2]) : 100};
+    int  threads{argc > 3 ? atoi(argv[3]) : 4};
+
+    printf("iterations: %ld, keys: %d, threads: %d, cpus: %u\n", iterations, keys, threads,
+           std::thread::hardware_concurrency());
+
+    for (int n : {1, threads})
+    {
+        printf("-- %d thread(s)\n", n);
+        measure("keyed_singleton<Venue, int>::instance()", iterations, keys, n,
+                [](int key) -> Venue& { return es::init::keyed_singleton<Venue, int>::instance(key); });
+        measure("singleton<map + std::mutex>", iterations, keys, n,
+                [](int key) -> Venue& { return es::init::singleton<venue_map<std::mutex>>::instance().get(key); });
+        measure("singleton<map + std::shared_mutex>", iterations, keys, n,
+                [](int key) -> Venue& { return es::init::singleton<shared_venue_map>::instance().get(key); });
+    }
+    return 0;
+}
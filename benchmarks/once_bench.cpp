@@ -0,0 +1,71 @@
+//
+// One time set up - es::init::once_function<Sig, Init, Fast>::call() vs std::call_once and a function local static.
+//
+//   build/once_bench [iterations]
+//
+
+#include <once_function.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+static uint32_t crc_table[256];
+
+static void build_crc_table()
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c{i};
+        for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+[[gnu::noinline]] static uint32_t crc_step(uint32_t crc, uint8_t byte)
+{
+    return crc_table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+}
+
+using once_crc = es::init::once_function<uint32_t(uint32_t, uint8_t), build_crc_table, crc_step>;
+
+static std::once_flag crc_once;
+[[gnu::noinline]] static uint32_t call_once_crc(uint32_t crc, uint8_t byte)
+{
+    std::call_once(crc_once, build_crc_table);
+    return crc_step(crc, byte);
+}
+
+[[gnu::noinline]] static uint32_t local_static_crc(uint32_t crc, uint8_t byte)
+{
+    static const bool built{(build_crc_table(), true)};
+    (void)built;
+    return crc_step(crc, byte);
+}
+
+template<typename F>
+static void measure(const char* name, long iterations, F&& f)
+{
+    uint32_t crc{0xffffffffU};
+    auto     start{std::chrono::steady_clock::now()};
+    for (long i = 0; i < iterations; ++i) crc = f(crc, static_cast<uint8_t>(i));
+    auto end{std::chrono::steady_clock::now()};
+    asm volatile("" : : "r"(crc));
+
+    double ns{std::chrono::duration<double, std::nano>(end - start).count()};
+    printf("%-36s %8.2f ns/call\n", name, ns / iterations);
+}
+
+int main(int argc, char** argv)
+{
+    long iterations{argc > 1 ? atol(argv[1]) : 100'000'000L};
+    printf("iterations: %ld\n", iterations);
+
+    measure("once_function::call()", iterations, [](uint32_t c, uint8_t b) { return once_crc::call(c, b); });
+    measure("std::call_once + function", iterations, call_once_crc);
+    measure("function local static + function", iterations, local_static_crc);
+    measure("crc_step(), no set up check", iterations, crc_step);
+    return 0;
+}
@@ -0,0 +1,124 @@
+//
+// Destruction stack push latency - the single word CAS of es::init::static_obj_stack vs a pointer and sequence number
+// top swapped by a 16 byte CAS (cmpxchg16b), pushed concurrently by several threads, and the first instance() calls of
+// many lazy singletons raced by the same threads.
+//
+//   build/stack_bench [pushes per thread] [threads]
+//
+
+#include <singleton.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct node
+{
+    node* _next;
+};
+
+// a top of a pointer and a sequence number, 16 byte CAS without -mcx16 on the command line.
+struct sequenced_stack
+{
+    __extension__ using uint128_t = unsigned __int128;
+    struct alignas(16) top_t
+    {
+        node*    _p;
+        uint64_t _seq;
+    };
+    inline static top_t top{nullptr, 0};
+
+    [[gnu::target("cx16")]] static void push(node* p)
+    {
+        uint128_t* unit{reinterpret_cast<uint128_t*>(&top)};
+        uint128_t  expected{__sync_val_compare_and_swap(unit, 0, 0)};
+        for (;;)
+        {
+            top_t stack_top;
+            __builtin_memcpy(&stack_top, &expected, sizeof(stack_top));
+            p->_next = stack_top._p;
+            top_t     new_top{p, stack_top._seq + 1};
+            uint128_t desired;
+            __builtin_memcpy(&desired, &new_top, sizeof(desired));
+            uint128_t seen{__sync_val_compare_and_swap(unit, expected, desired)};
+            if (seen == expected) return;
+            expected = seen;
+        }
+    }
+};
+
+template<typename F>
+static void measure(const char* name, long pushes, int threads, F&& push)
+{
+    std::vector<std::vector<node>> nodes(threads, std::vector<node>(pushes));
+    std::vector<std::thread>       workers;
+    std::atomic<int>               ready{0};
+    std::atomic<long>              total_ns{0};
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]() {
+            ++ready;
+            while (ready.load() < threads) std::this_thread::yield();
+            auto start{std::chrono::steady_clock::now()};
+            for (auto& n : nodes[t]) push(&n);
+            auto end{std::chrono::steady_clock::now()};
+            total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        });
+    for (auto& w : workers) w.join();
+    printf("%-44s %8.2f ns/push\n", name, double(total_ns.load()) / (double(pushes) * threads));
+}
+
+template<int I>
+struct lazy_object
+{
+    int _value{I};
+};
+
+template<std::size_t... I>
+static constexpr auto lazy_instances(std::index_sequence<I...>)
+{
+    return std::array<void (*)(), sizeof...(I)>{
+        []() { es::init::singleton<lazy_object<int(I)>, es::init::lazy_initializer>::instance(); }...};
+}
+
+// every thread calls instance() of all the lazy singletons, from a different start - one construction each.
+static void first_access(int threads)
+{
+    static constexpr auto    instances{lazy_instances(std::make_index_sequence<512>{})};
+    std::vector<std::thread> workers;
+    std::atomic<int>         ready{0};
+    auto                     start{std::chrono::steady_clock::now()};
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]() {
+            ++ready;
+            while (ready.load() < threads) std::this_thread::yield();
+            for (std::size_t i = 0; i < instances.size(); ++i) instances[(i + 97 * t) % instances.size()]();
+        });
+    for (auto& w : workers) w.join();
+    auto   end{std::chrono::steady_clock::now()};
+    double ns{std::chrono::duration<double, std::nano>(end - start).count()};
+    printf("%-44s %8.2f ns/singleton, stack size: %lu\n", "first instance() of 512 lazy singletons", ns / 512,
+           es::init::stack::size());
+}
+
+int main(int argc, char** argv)
+{
+    long pushes{argc > 1 ? atol(argv[1]) : 1'000'000L};
+    int  threads{argc > 2 ? atoi(argv[2]) : 4};
+
+    printf("pushes per thread: %ld, threads: %d, cpus: %u\n", pushes, threads, std::thread::hardware_concurrency());
+    for (int n : {1, threads})
+    {
+        printf("-- %d thread(s)\n", n);
+        es::init::static_obj_stack<node>::top.store(nullptr);
+        measure("static_obj_stack - 8 byte CAS", pushes, n, [](node* p) { es::init::static_obj_stack<node>::push(p); });
+        sequenced_stack::top = {nullptr, 0};
+        measure("sequenced top - 16 byte CAS", pushes, n, [](node* p) { sequenced_stack::push(p); });
+    }
+    first_access(threads);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+#
+# Startup benchmark - generates a project of many singleton types spread over many translation units, builds it and
+# measures: compile and link time, binary size, static initialization time, lazy construction time and time-to-exit.
+#
+# The static initialization is timed inside the process, from a constructor(101) function, which runs before the
+# singletons' early initializers, to main(). The time from the end of main() to the process end is measured by the
+# parent, less the same time of an empty program, which is the fork/exec/wait overhead of the benchmark.
+#
+#   benchmarks/startup_bench.py --types 10000 --tus 500 --lazy 0.3 --chain 8 --fanout 4
+#   benchmarks/startup_bench.py --cxxflags='-DSOME_POLICY=1'     # compare an alternative storage / access policy
+#
+# Dependencies: type i depends on type i-1 within chains of --chain types, and every --fanout-every'th type depends on
+# --fanout earlier types, possibly in other translation units.
+#
+# MIT License
+#
+# Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+#  http://github.com/erez-strauss/init_singleton/
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+import argparse
+import concurrent.futures
+import os
+import random
+import shlex
+import statistics
+import subprocess
+import sys
+import time
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="init_singleton startup benchmark")
+    p.add_argument("--types", type=int, default=1000, help="number of singleton types")
+    p.add_argument("--tus", type=int, default=50, help="number of translation units")
+    p.add_argument("--lazy", type=float, default=0.3, help="fraction of lazy initialized singletons")
+    p.add_argument("--chain", type=int, default=8, help="length of dependency chains")
+    p.add_argument("--fanout", type=int, default=4, help="dependencies of a fan-out type")
+    p.add_argument("--fanout-every", type=int, default=16, help="every N'th type is a fan-out type")
+    p.add_argument("--runs", type=int, default=10, help="number of measured executions")
+    p.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel compilations")
+    p.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    p.add_argument("--cxxflags", default="-std=c++17 -O2 -pthread")
+    p.add_argument("--dir", default="/tmp/es_init_startup_bench", help="generated project directory")
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args()
+
+
+NOW_NS = ("static long now_ns()\n{\n    timespec ts{};\n    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+          "    return ts.tv_sec * 1000000000L + ts.tv_nsec;\n}\n\n")
+
+
+def dependencies(args, rnd):
+    deps = []
+    for i in range(args.types):
+        d = set()
+        if i % args.chain:
+            d.add(i - 1)
+        if i and i % args.fanout_every == 0:
+            d.update(rnd.sample(range(i), min(i, args.fanout)))
+        deps.append(sorted(d))
+    return deps
+
+
+def generate(args):
+    rnd = random.Random(args.seed)
+    deps = dependencies(args, rnd)
+    lazy = [rnd.random() < args.lazy for _ in range(args.types)]
+    os.makedirs(args.dir, exist_ok=True)
+
+    with open(os.path.join(args.dir, "bench_types.h"), "w") as f:
+        f.write("#pragma once\n#include <singleton.h>\n\n")
+        for i in range(args.types):
+            policy = "es::init::lazy_initializer" if lazy[i] else "es::init::early_initializer"
+            f.write(f"struct S{i} {{ S{i}(); unsigned long _v; }};\n")
+            f.write(f"using A{i} = es::init::singleton<S{i}, {policy}>;\n")
+        f.write("\n")
+        for t in range(args.tus):
+            f.write(f"unsigned long touch_tu{t}();\n")
+
+    per_tu = (args.types + args.tus - 1) // args.tus
+    sources = []
+    for t in range(args.tus):
+        name = os.path.join(args.dir, f"tu{t}.cpp")
+        sources.append(name)
+        types = range(t * per_tu, min(args.types, (t + 1) * per_tu))
+        with open(name, "w") as f:
+            f.write('#include "bench_types.h"\n\n')
+            for i in types:
+                init = " + ".join([f"A{d}::instance()._v" for d in deps[i]] or ["0"])
+                f.write(f"S{i}::S{i}() : _v({init} + {i}) {{}}\n")
+            f.write(f"\nunsigned long touch_tu{t}()\n{{\n    unsigned long v{{0}};\n")
+            for i in types:
+                f.write(f"    v += A{i}::instance()._v;\n")
+            f.write("    return v;\n}\n")
+
+    main = os.path.join(args.dir, "main.cpp")
+    sources.append(main)
+    with open(main, "w") as f:
+        f.write('#include "bench_types.h"\n#include <time.h>\n#include <cstdio>\n\n')
+        f.write(NOW_NS)
+        f.write("static long start_ns;\n")
+        f.write("[[gnu::constructor(101)]] static void stamp_start() { start_ns = now_ns(); }\n\n")
+        f.write("int main()\n{\n    long main_ns{now_ns()};\n")
+        f.write("    unsigned long v{0};\n")
+        for t in range(args.tus):
+            f.write(f"    v += touch_tu{t}();\n")
+        f.write("    long touched_ns{now_ns()};\n")
+        f.write('    printf("init_to_main_ns %ld\\nlazy_touch_ns %ld\\nsum %lu\\nmain_exit_ns %ld\\n", '
+                "main_ns - start_ns, touched_ns - main_ns, v, now_ns());\n")
+        f.write("    return 0;\n}\n")
+
+    # no singletons, the process spawn and exit overhead.
+    with open(os.path.join(args.dir, "baseline.cpp"), "w") as f:
+        f.write("#include <time.h>\n#include <cstdio>\n\n")
+        f.write(NOW_NS)
+        f.write('int main()\n{\n    printf("init_to_main_ns 0\\nlazy_touch_ns 0\\nmain_exit_ns %ld\\n", now_ns());\n')
+        f.write("    return 0;\n}\n")
+    return sources
+
+
+def build(args, sources):
+    flags = shlex.split(args.cxxflags) + ["-I", REPO]
+    objects = [s[:-4] + ".o" for s in sources]
+
+    def compile_one(src_obj):
+        start = time.monotonic()
+        subprocess.run([args.cxx] + flags + ["-c", "-o", src_obj[1], src_obj[0]], check=True)
+        return time.monotonic() - start
+
+    start = time.monotonic()
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        compile_times = list(pool.map(compile_one, zip(sources, objects)))
+    compile_wall = time.monotonic() - start
+
+    binary = os.path.join(args.dir, "startup_bench")
+    start = time.monotonic()
+    subprocess.run([args.cxx] + flags + ["-o", binary] + objects, check=True)
+    link_wall = time.monotonic() - start
+
+    baseline = os.path.join(args.dir, "baseline")
+    subprocess.run([args.cxx] + flags + ["-o", baseline, os.path.join(args.dir, "baseline.cpp")], check=True)
+    return binary, baseline, compile_wall, sum(compile_times), link_wall
+
+
+def run(binary):
+    out = subprocess.run([binary], check=True, capture_output=True, text=True).stdout
+    end_ns = time.monotonic_ns()  # CLOCK_MONOTONIC on Linux
+    values = dict(line.split() for line in out.splitlines())
+    return int(values["init_to_main_ns"]), int(values["lazy_touch_ns"]), end_ns - int(values["main_exit_ns"])
+
+
+def text_size(binary):
+    out = subprocess.run(["size", binary], check=True, capture_output=True, text=True).stdout.splitlines()
+    return int(out[1].split()[0])
+
+
+def main():
+    args = parse_args()
+    sources = generate(args)
+    binary, baseline, compile_wall, compile_cpu, link_wall = build(args, sources)
+    samples = [run(binary) for _ in range(args.runs)]
+    baseline_exit = statistics.median(run(baseline)[2] for _ in range(args.runs)) / 1000.0
+
+    median = lambda i: statistics.median(s[i] for s in samples) / 1000.0
+    size = os.path.getsize(binary)
+    text = text_size(binary)
+    print(f"types: {args.types} tus: {args.tus} lazy: {args.lazy} chain: {args.chain} fanout: {args.fanout}")
+    print(f"cxx: {args.cxx} {args.cxxflags}")
+    print(f"compile wall: {compile_wall:.2f} s, compile sum: {compile_cpu:.2f} s, link: {link_wall:.2f} s")
+    print(f"binary size: {size} bytes, text: {text} bytes, text per singleton: {text / args.types:.1f} bytes")
+    print(f"static init to main: {median(0):.1f} us, lazy touch: {median(1):.1f} us, main exit to process end: "
+          f"{median(2) - baseline_exit:.1f} us, less {baseline_exit:.1f} us of an empty program (median of {args.runs})")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
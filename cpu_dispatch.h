@@ -0,0 +1,256 @@
+//
+// cpu_dispatch - select the best SIMD implementation once, before main(), no feature check on the calls.
+//
+// cpu_features reads CPUID (and XGETBV - the OS saves the wide registers) once and sets the SIMD tier of the machine:
+// scalar, sse4.2, avx2 or avx512 (F, BW, DQ and VL). ES_INIT_SIMD_TIER=scalar|sse4.2|avx2|avx512 in the environment
+// caps it, to test the lower tiers on any x86 machine - a tier above the machine's is ignored, with a warning.
+//
+// Free functions - dispatch_function<Sig, simd_impl<tier, function>...>::call(args...):
+//
+// using count = es::init::dispatch_function<size_t(const char*, size_t),
+//                                           es::init::simd_impl<es::init::simd_tier::scalar, count_scalar>,
+//                                           es::init::simd_impl<es::init::simd_tier::avx2, count_avx2>>;
+// size_t n{count::call(p, size)};
+//
+// The function pointer is bound by an early singleton, like singleton<T>::instance() it starts at a routine that binds
+// it (when called before the early initialization), then every call is one indirect call through a pointer that does
+// not change, with no condition - predicted as well as a direct call.
+//
+// Objects - dispatch_singleton<Interface, Impls...>::instance() is the Interface of one object, of the Impl with the
+// highest tier the machine supports. Every Impl derives from Interface and has a static constexpr simd_tier tier.
+//
+// One of the implementations must be scalar. The functions of the higher tiers are compiled for their instruction
+// set with __attribute__((target("avx2"))) or in their own translation units, never called on a machine without it.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <app_singletons.h>
+#include <singleton.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace es::init {
+
+enum class simd_tier : uint32_t
+{
+    scalar = 0,
+    sse42  = 1,
+    avx2   = 2,
+    avx512 = 3,
+};
+
+constexpr const char* simd_tier_names[]{"scalar", "sse4.2", "avx2", "avx512"};
+
+inline const char* to_string(simd_tier tier) noexcept { return simd_tier_names[static_cast<uint32_t>(tier)]; }
+
+class cpu_features
+{
+public:
+    cpu_features() : _detected(detect()), _tier(_detected)
+    {
+        const char* forced{singleton<app_env>::instance().get("ES_INIT_SIMD_TIER")};
+        if (forced && *forced)
+        {
+            simd_tier tier{simd_tier::scalar};
+            if (!parse(forced, tier))
+                diagnostic{} << "Warning: ES_INIT_SIMD_TIER: unknown tier: " << forced;
+            else if (tier > _detected)
+                diagnostic{} << "Warning: ES_INIT_SIMD_TIER: " << forced << " is not supported, using "
+                             << to_string(_detected);
+            else
+                _tier = tier;
+        }
+    }
+
+    // the tier the dispatchers select
+    simd_tier tier() const noexcept { return _tier; }
+    // the tier of the machine, before ES_INIT_SIMD_TIER
+    simd_tier detected() const noexcept { return _detected; }
+
+    static bool parse(std::string_view name, simd_tier& tier) noexcept
+    {
+        for (uint32_t i = 0; i < std::size(simd_tier_names); ++i)
+            if (name == simd_tier_names[i])
+            {
+                tier = static_cast<simd_tier>(i);
+                return true;
+            }
+        return false;
+    }
+
+    static simd_tier detect() noexcept
+    {
+#if defined(__x86_64__)
+        unsigned a{0}, b{0}, c{0}, d{0};
+        if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_2)) return simd_tier::scalar;
+        const bool avx{(c & bit_AVX) && (c & bit_OSXSAVE)};
+        if (!avx || !__get_cpuid_count(7, 0, &a, &b, &c, &d)) return simd_tier::sse42;
+
+        const uint64_t xcr0{xgetbv()};
+        if (!(b & bit_AVX2) || (xcr0 & 0x6U) != 0x6U) return simd_tier::sse42;  // XMM and YMM state
+        const unsigned avx512{bit_AVX512F | bit_AVX512BW | bit_AVX512DQ | bit_AVX512VL};
+        if ((b & avx512) != avx512 || (xcr0 & 0xe0U) != 0xe0U) return simd_tier::avx2;  // opmask and ZMM state
+        return simd_tier::avx512;
+#else
+        return simd_tier::scalar;
+#endif
+    }
+
+private:
+#if defined(__x86_64__)
+    static uint64_t xgetbv() noexcept
+    {
+        uint32_t eax{0}, edx{0};
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+    }
+#endif
+
+    simd_tier _detected;
+    simd_tier _tier;
+};
+
+using cpu_features_singleton = singleton<cpu_features>;
+
+template<typename... Impls>
+constexpr bool has_scalar_impl{((Impls::tier == simd_tier::scalar) || ...)};
+
+// the index of the implementation with the highest tier not above the given one.
+template<typename... Impls>
+std::size_t select_impl(simd_tier tier) noexcept
+{
+    constexpr simd_tier tiers[]{Impls::tier...};
+    std::size_t         best{0};
+    for (std::size_t i = 0; i < sizeof...(Impls); ++i)
+        if (tiers[i] <= tier && (tiers[best] > tier || tiers[i] > tiers[best])) best = i;
+    return best;
+}
+
+template<simd_tier Tier, auto Function>
+struct simd_impl
+{
+    static constexpr simd_tier tier{Tier};
+    static constexpr auto      function{Function};
+};
+
+template<typename Sig, typename... Impls>
+class dispatch_function;
+
+template<typename R, typename... Args, typename... Impls>
+class dispatch_function<R(Args...), Impls...>
+{
+    static_assert(has_scalar_impl<Impls...>, "dispatch_function: no scalar implementation");
+    using function_type = R (*)(Args...);
+
+    // binds _function, before main() - its singleton is early initialized.
+    struct binder
+    {
+        binder()
+        {
+            static constexpr function_type functions[]{Impls::function...};
+            _index = select_impl<Impls...>(cpu_features_singleton::instance().tier());
+            _function.store(functions[_index], std::memory_order_release);
+        }
+        std::size_t _index;
+    };
+
+    static R bind_and_call(Args... arguments)
+    {
+        singleton<binder>::instance();
+        return _function.load(std::memory_order_acquire)(std::forward<Args>(arguments)...);
+    }
+
+    inline static std::atomic<function_type> _function{bind_and_call};
+
+public:
+    [[using gnu: hot]] static R call(Args... arguments)
+    {
+        return _function.load(std::memory_order_relaxed)(std::forward<Args>(arguments)...);
+    }
+
+    static simd_tier tier() { return std::array<simd_tier, sizeof...(Impls)>{Impls::tier...}[index()]; }
+    static std::size_t index() { return singleton<binder>::instance()._index; }
+};
+
+// the object of the selected implementation, in place.
+template<typename Interface, typename... Impls>
+class dispatch_holder
+{
+    static_assert(has_scalar_impl<Impls...>, "dispatch_singleton: no scalar implementation");
+    static_assert((std::is_base_of_v<Interface, Impls> && ...), "dispatch_singleton: an Impl is not an Interface");
+    static_assert(std::has_virtual_destructor_v<Interface>, "dispatch_singleton: Interface without virtual destructor");
+
+public:
+    dispatch_holder() : _index(select_impl<Impls...>(cpu_features_singleton::instance().tier()))
+    {
+        construct(std::index_sequence_for<Impls...>{});
+    }
+    ~dispatch_holder() { _object->~Interface(); }
+    dispatch_holder(const dispatch_holder&) = delete;
+    dispatch_holder& operator=(const dispatch_holder&) = delete;
+
+    Interface&  object() noexcept { return *_object; }
+    std::size_t index() const noexcept { return _index; }
+
+private:
+    template<std::size_t... I>
+    void construct(std::index_sequence<I...>)
+    {
+        ((_index == I ? (void)(_object = new (_storage) Impls{}) : (void)0), ...);
+    }
+
+    std::size_t _index;
+    Interface*  _object{nullptr};
+    alignas(Impls...) unsigned char _storage[std::max({sizeof(Impls)...})];
+};
+
+template<typename Interface, typename... Impls>
+class dispatch_singleton
+{
+    using holder_singleton = singleton<dispatch_holder<Interface, Impls...>>;
+
+public:
+    [[using gnu: hot]] static Interface& instance() { return holder_singleton::instance().object(); }
+    static simd_tier tier()
+    {
+        return std::array<simd_tier, sizeof...(Impls)>{Impls::tier...}[holder_singleton::instance().index()];
+    }
+};
+
+}  // namespace es::init
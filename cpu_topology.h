@@ -0,0 +1,267 @@
+//
+// cpu_topology - the machine's CPUs, cores, SMT siblings, NUMA nodes and cache sizes, read from sysfs once, before
+// main(), and the CPUs the process is allowed to run on. Plus helpers to pin threads and to choose per node CPUs.
+//
+// auto& topology{es::init::cpu_topology_singleton::instance()};
+// for (unsigned i = 0; i < workers; ++i)
+//     threads.emplace_back([&, i]() { topology.pin_current_thread(topology.cpu_for(node, i)); ... });
+//
+// The files are read under a root directory, "/" by default, or ES_INIT_TOPOLOGY_ROOT from the environment:
+//   <root>/sys/devices/system/cpu/online
+//   <root>/sys/devices/system/cpu/cpu<N>/topology/{core_id,physical_package_id,thread_siblings_list}
+//   <root>/sys/devices/system/cpu/cpu<N>/cache/index<K>/{level,type,size}
+//   <root>/sys/devices/system/node/node<M>/cpulist
+//   <root>/proc/self/status (Cpus_allowed_list)
+// so a synthetic topology, a directory tree of those files, can be tested on any machine. Missing files are
+// defaults: no nodes - one node 0, no cache - size 0, no Cpus_allowed_list - all the online CPUs.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <app_singletons.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <singleton.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace es::init {
+
+class cpu_topology
+{
+public:
+    struct cpu_info
+    {
+        uint16_t _cpu;
+        uint16_t _core;     // index of the physical core, unique over the packages
+        uint16_t _package;
+        uint16_t _node;
+        uint16_t _smt;      // index among the core's SMT siblings, 0 - the first hardware thread
+        uint16_t _siblings;  // number of hardware threads of the core
+        bool     _allowed;  // in the process's CPU affinity set
+        uint32_t _l1d_kb;
+        uint32_t _l2_kb;
+        uint32_t _l3_kb;
+    };
+
+    cpu_topology() : cpu_topology(default_root()) {}
+
+    explicit cpu_topology(std::string root) : _root(std::move(root))
+    {
+        if (_root.empty() || _root.back() != '/') _root += '/';
+        const std::string cpu_dir{_root + "sys/devices/system/cpu/"};
+
+        std::vector<uint16_t> online{parse_list(read_file(cpu_dir + "online"))};
+        if (online.empty())
+            for (long n = ::sysconf(_SC_NPROCESSORS_ONLN), i = 0; i < n; ++i) online.push_back(uint16_t(i));
+
+        std::vector<uint16_t> allowed{allowed_list(_root + "proc/self/status")};
+
+        std::vector<std::pair<unsigned, unsigned>> cores;  // (package, core_id) of each core index
+        for (uint16_t cpu : online)
+        {
+            const std::string dir{cpu_dir + "cpu" + std::to_string(cpu) + "/"};
+            cpu_info          info{};
+            info._cpu     = cpu;
+            info._package = uint16_t(read_number(dir + "topology/physical_package_id"));
+
+            std::pair<unsigned, unsigned> core{info._package, read_number(dir + "topology/core_id", cpu)};
+            auto it{std::find(cores.begin(), cores.end(), core)};
+            info._core = uint16_t(it - cores.begin());
+            if (it == cores.end()) cores.push_back(core);
+
+            std::vector<uint16_t> siblings{parse_list(read_file(dir + "topology/thread_siblings_list"))};
+            auto                  self{std::find(siblings.begin(), siblings.end(), cpu)};
+            info._siblings = uint16_t(siblings.empty() ? 1 : siblings.size());
+            info._smt      = uint16_t(self == siblings.end() ? 0 : self - siblings.begin());
+            info._allowed  = allowed.empty() || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end();
+
+            for (unsigned index = 0;; ++index)
+            {
+                const std::string cache{dir + "cache/index" + std::to_string(index) + "/"};
+                std::string       type{read_file(cache + "type")};
+                if (type.empty()) break;
+                unsigned level{read_number(cache + "level")};
+                uint32_t kb{parse_size_kb(read_file(cache + "size"))};
+                if (level == 1 && type.compare(0, 4, "Data") == 0) info._l1d_kb = kb;
+                if (level == 2) info._l2_kb = kb;
+                if (level == 3) info._l3_kb = kb;
+            }
+            _cpus.push_back(info);
+        }
+        _cores = unsigned(cores.size());
+
+        const std::string node_dir{_root + "sys/devices/system/node/"};
+        for (uint16_t node : parse_list(read_file(node_dir + "online")))
+        {
+            for (uint16_t cpu : parse_list(read_file(node_dir + "node" + std::to_string(node) + "/cpulist")))
+                for (auto& c : _cpus)
+                    if (c._cpu == cpu) c._node = node;
+            _nodes = std::max(_nodes, unsigned(node) + 1);
+        }
+        if (_nodes == 0) _nodes = 1;
+    }
+
+    // the online CPUs, in CPU number order.
+    const std::vector<cpu_info>& cpus() const noexcept { return _cpus; }
+    unsigned                     cores() const noexcept { return _cores; }
+    unsigned                     nodes() const noexcept { return _nodes; }
+    const std::string&           root() const noexcept { return _root; }
+
+    const cpu_info* find(unsigned cpu) const noexcept
+    {
+        for (auto& c : _cpus)
+            if (c._cpu == cpu) return &c;
+        return nullptr;
+    }
+
+    // the allowed CPUs of the node, one hardware thread of every core first, then their SMT siblings.
+    std::vector<uint16_t> node_cpus(unsigned node) const
+    {
+        std::vector<const cpu_info*> selected;
+        for (auto& c : _cpus)
+            if (c._allowed && c._node == node) selected.push_back(&c);
+        std::stable_sort(selected.begin(), selected.end(),
+                         [](const cpu_info* a, const cpu_info* b) { return a->_smt < b->_smt; });
+        std::vector<uint16_t> result;
+        for (auto c : selected) result.push_back(c->_cpu);
+        return result;
+    }
+
+    // the i'th CPU of node_cpus(node), wraps around, -1 if the node has no allowed CPU.
+    int cpu_for(unsigned node, unsigned i) const
+    {
+        std::vector<uint16_t> node_list{node_cpus(node)};
+        return node_list.empty() ? -1 : node_list[i % node_list.size()];
+    }
+
+    // pthread_setaffinity_np() error code, 0 on success, EINVAL for a cpu out of the CPU ids range. The set is
+    // allocated for the cpu, a cpu_set_t holds CPU_SETSIZE CPUs only.
+    static int pin_thread(pthread_t thread, unsigned cpu) noexcept
+    {
+        if (cpu > UINT16_MAX) return EINVAL;
+        cpu_set_t* set{CPU_ALLOC(cpu + 1)};
+        if (!set) return ENOMEM;
+        const std::size_t size{CPU_ALLOC_SIZE(cpu + 1)};
+        CPU_ZERO_S(size, set);
+        CPU_SET_S(cpu, size, set);
+        int error{::pthread_setaffinity_np(thread, size, set)};
+        CPU_FREE(set);
+        return error;
+    }
+    static int pin_current_thread(unsigned cpu) noexcept { return pin_thread(::pthread_self(), cpu); }
+
+    // cpu list format: "0-3,8,10-11\n".
+    static std::vector<uint16_t> parse_list(std::string_view s)
+    {
+        std::vector<uint16_t> result;
+        std::size_t           i{0};
+        auto                  number = [&]() {
+            unsigned n{0};
+            while (i < s.size() && s[i] >= '0' && s[i] <= '9') n = n * 10 + unsigned(s[i++] - '0');
+            return n;
+        };
+        while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+        {
+            unsigned first{number()}, last{first};
+            if (i < s.size() && s[i] == '-')
+            {
+                ++i;
+                last = number();
+            }
+            for (unsigned n = first; n <= last; ++n) result.push_back(uint16_t(n));
+            if (i < s.size() && s[i] == ',') ++i;
+        }
+        return result;
+    }
+
+private:
+    static std::string default_root()
+    {
+        const char* root{singleton<app_env>::instance().get("ES_INIT_TOPOLOGY_ROOT")};
+        return root ? root : "/";
+    }
+
+    // the file content, empty if it can not be read.
+    static std::string read_file(const std::string& path)
+    {
+        std::string content;
+        int         fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd < 0) return content;
+        char    buf[4096];
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof(buf))) > 0) content.append(buf, std::size_t(n));
+        ::close(fd);
+        return content;
+    }
+
+    static unsigned read_number(const std::string& path, unsigned default_value = 0)
+    {
+        std::string s{read_file(path)};
+        if (s.empty() || s[0] < '0' || s[0] > '9') return default_value;
+        return unsigned(std::stoul(s));
+    }
+
+    // "32K", "1024K", "32M"
+    static uint32_t parse_size_kb(const std::string& s)
+    {
+        if (s.empty() || s[0] < '0' || s[0] > '9') return 0;
+        std::size_t end{0};
+        uint32_t    n{uint32_t(std::stoul(s, &end))};
+        if (end < s.size() && s[end] == 'M') return n * 1024;
+        if (end < s.size() && s[end] == 'K') return n;
+        return n / 1024;
+    }
+
+    static std::vector<uint16_t> allowed_list(const std::string& status_path)
+    {
+        std::string      status{read_file(status_path)};
+        std::string_view key{"Cpus_allowed_list:"};
+        auto             pos{status.find(key)};
+        if (pos == std::string::npos) return {};
+        pos = status.find_first_not_of(" \t", pos + key.size());
+        if (pos == std::string::npos) return {};
+        return parse_list(std::string_view{status}.substr(pos));
+    }
+
+    std::string           _root;
+    std::vector<cpu_info> _cpus;
+    unsigned              _cores{0};
+    unsigned              _nodes{0};
+};
+
+using cpu_topology_singleton = singleton<cpu_topology>;
+
+}  // namespace es::init
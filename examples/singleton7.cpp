@@ -1,4 +1,6 @@
 #include <singleton.h>
+#include <iostream>
+
 class DataA
 {
 public:
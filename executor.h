@@ -0,0 +1,262 @@
+//
+// executor - one work-stealing thread pool for all the singletons, instead of each spawning its own threads.
+//
+// A singleton that uses the executor accesses it from its constructor:
+//
+// struct Cache { Cache() : _pool(es::init::executor_singleton::instance()) {} ~Cache() { /* may still submit */ } };
+//
+// so the executor is constructed before it and, in empty_stack()'s reverse creation order, destroyed after it.
+// The executor's destructor runs all the queued tasks, including tasks submitted by running tasks, then stops and
+// joins its threads. A task submitted after that runs in the submitting thread.
+//
+// Every worker has its own deque: it pops its newest task, and steals the oldest task of another worker when its
+// own deque is empty. Tasks submitted from a worker go to its deque, others are spread round robin.
+// A submit locks only its deque, an idle worker sleeps on a futex eventcount - the executor's mutex is taken when it
+// becomes idle and when it stops.
+// The number of workers is ES_INIT_EXECUTOR_THREADS from the environment (1 to max_threads), or the number of allowed
+// CPUs. The executor_singleton is lazy, its threads are started by its first access, not before main().
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <app_singletons.h>
+#include <cpu_topology.h>
+#include <linux/futex.h>
+#include <singleton.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace es::init {
+
+class executor
+{
+public:
+    using task = std::function<void()>;
+
+    static constexpr unsigned max_threads{1024};
+
+    executor() : executor(default_threads()) {}
+
+    explicit executor(unsigned threads) : _size(threads ? threads : 1), _queues(new queue[_size])
+    {
+        _workers.reserve(_size);
+        for (unsigned i = 0; i < _size; ++i) _workers.emplace_back([this, i]() { run(i); });
+    }
+
+    ~executor()
+    {
+        wait_idle();
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _stop.store(true);
+        }
+        wake(INT_MAX);
+        for (auto& w : _workers) w.join();
+    }
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    // after the destructor stopped the workers, the task runs in the calling thread.
+    template<typename F>
+    void submit(F&& f)
+    {
+        // pending before the _stop check: the workers do not exit while a task, queued after the stop, is pending.
+        _pending.fetch_add(1);
+        if (_stop.load())
+        {
+            done_one();
+            f();
+            return;
+        }
+        unsigned q{current_executor == this ? current_worker : _next.fetch_add(1, std::memory_order_relaxed) % _size};
+        {
+            std::lock_guard<std::mutex> guard(_queues[q]._mutex);
+            _queues[q]._tasks.emplace_back(std::forward<F>(f));
+        }
+        _queued.fetch_add(1);
+        if (_sleepers.load()) wake(1);  // seq_cst, a worker going to sleep sees the task or is counted here
+    }
+
+    // waits until all the submitted tasks, and the tasks they submit, are done. Not from a task.
+    void wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle_cv.wait(lock, [this]() { return _pending.load() == 0; });
+    }
+
+    unsigned size() const noexcept { return _size; }
+
+    // the index of the calling worker thread, -1 if it is not a worker of this executor.
+    int worker_index() const noexcept { return current_executor == this ? int(current_worker) : -1; }
+
+private:
+    struct alignas(64) queue
+    {
+        std::mutex       _mutex;
+        std::deque<task> _tasks;
+    };
+
+    static unsigned default_threads()
+    {
+        if (const char* n{singleton<app_env>::instance().get("ES_INIT_EXECUTOR_THREADS")})
+        {
+            char* end{nullptr};
+            errno = 0;
+            unsigned long threads{std::strtoul(n, &end, 10)};
+            if (end != n && *end == '\0' && errno == 0 && threads >= 1 && threads <= max_threads)
+                return static_cast<unsigned>(threads);
+            diagnostic{} << "Warning: executor: invalid ES_INIT_EXECUTOR_THREADS: '" << n << "', using the allowed CPUs";
+        }
+        unsigned allowed{0};
+        for (auto& c : cpu_topology_singleton::instance().cpus()) allowed += c._allowed;
+        return allowed;
+    }
+
+    bool pop(unsigned q, task& t, bool newest)
+    {
+        std::lock_guard<std::mutex> guard(_queues[q]._mutex);
+        auto&                       tasks{_queues[q]._tasks};
+        if (tasks.empty()) return false;
+        if (newest)
+        {
+            t = std::move(tasks.back());
+            tasks.pop_back();
+        }
+        else
+        {
+            t = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        _queued.fetch_sub(1);
+        return true;
+    }
+
+    bool take(unsigned i, task& t)
+    {
+        if (pop(i, t, true)) return true;
+        for (unsigned n = 1; n < _size; ++n)
+            if (pop((i + n) % _size, t, false)) return true;
+        return false;
+    }
+
+    void run(unsigned i)
+    {
+        current_executor = this;
+        current_worker   = i;
+        task t;
+        for (;;)
+        {
+            if (take(i, t))
+            {
+                try
+                {
+                    t();
+                }
+                catch (const std::exception& e)
+                {
+                    diagnostic{} << "Error: executor task exception: " << e.what();
+                }
+                catch (...)
+                {
+                    diagnostic{} << "Error: executor task exception";
+                }
+                t = nullptr;
+                done_one();
+                continue;
+            }
+            if (_stop.load() && _pending.load() == 0) return;
+            sleep();
+        }
+    }
+
+    // the idle edge: wait_idle() and, after the stop, the workers waiting for the last pending task.
+    void done_one()
+    {
+        if (_pending.fetch_sub(1) != 1) return;
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _idle_cv.notify_all();
+        }
+        if (_stop.load()) wake(INT_MAX);
+    }
+
+    // eventcount: the epoch is read before the worker is counted as a sleeper, a wake up after it fails the wait.
+    void sleep()
+    {
+        const uint32_t epoch{_epoch.load()};
+        _sleepers.fetch_add(1);
+        if (_queued.load() == 0 && !(_stop.load() && _pending.load() == 0))
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_epoch), FUTEX_WAIT_PRIVATE, epoch, nullptr, nullptr, 0);
+        _sleepers.fetch_sub(1);
+    }
+
+    void wake(int workers)
+    {
+        _epoch.fetch_add(1);
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_epoch), FUTEX_WAKE_PRIVATE, workers, nullptr, nullptr, 0);
+    }
+
+    inline static thread_local executor* current_executor{nullptr};
+    inline static thread_local unsigned  current_worker{0};
+
+    const unsigned           _size;
+    std::unique_ptr<queue[]> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<unsigned>    _next{0};
+    std::atomic<long>        _queued{0};   // in the deques
+    std::atomic<long>        _pending{0};  // queued or running
+    std::atomic<bool>        _stop{false};
+    alignas(64) std::atomic<uint32_t> _epoch{0};  // futex word
+    std::atomic<uint32_t>             _sleepers{0};
+    std::mutex                        _mutex;
+    std::condition_variable           _idle_cv;
+};
+
+// the parent's threads do not exist in the child.
+template<>
+struct fork_policy_traits<executor>
+{
+    static constexpr fork_policy value{fork_policy::reinit_in_child};
+};
+
+using executor_singleton = singleton<executor, lazy_initializer>;
+
+}  // namespace es::init
@@ -0,0 +1,258 @@
+//
+// init_arena - bump allocation arena for the long lived structures a singleton builds in its constructor.
+//
+// arena_singleton<T> constructs T with its own arena as the current arena: containers using es::init::arena_allocator
+// (default constructed - bound to the current arena) allocate from contiguous arena chunks, not interleaved with the
+// other start up allocations. After T's destructor, the arena releases all its chunks in one step, the allocator's
+// deallocate() is a no-op.
+//
+// struct Index
+// {
+//     Index() { for (...) _ids.push_back(...); }
+//     std::vector<uint64_t, es::init::arena_allocator<uint64_t>> _ids;
+// };
+// auto& index{es::init::arena_singleton<Index>::instance()};
+//
+// Specialize arena_release_only<T> when T's destructor only frees arena memory, it is then skipped, and the teardown is
+// the release of the chunks - no walk over the nodes of T's containers.
+//
+// arena_singleton<T, Tag> shares the arena of all the singletons with the same Tag, it is released after all of them.
+// Memory the allocator frees is not reused, allocations after the construction still come from the arena, so growing
+// structures should switch to the heap. Every singleton construction starts without a current arena, a dependency
+// constructed from T's constructor uses its own.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace es::init {
+
+class init_arena
+{
+public:
+    static constexpr std::size_t page_size{4096};
+
+    init_arena() noexcept : init_arena(64 * 1024) {}
+    explicit init_arena(std::size_t chunk_size) noexcept : _chunk_size(chunk_size) {}
+    ~init_arena() { release(); }
+    init_arena(const init_arena&) = delete;
+    init_arena& operator=(const init_arena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t align)
+    {
+        std::lock_guard<tc_spin_lock> guard(_lock);
+
+        uintptr_t p{(reinterpret_cast<uintptr_t>(_cur) + align - 1) & ~(align - 1)};
+        if (!_cur || p + size > reinterpret_cast<uintptr_t>(_end))
+        {
+            new_chunk(size + align);
+            p = (reinterpret_cast<uintptr_t>(_cur) + align - 1) & ~(align - 1);
+        }
+        _cur = reinterpret_cast<char*>(p + size);
+        _allocated += size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    // unmaps all the chunks, the memory allocated from the arena is no longer valid.
+    void release() noexcept
+    {
+        while (_chunks)
+        {
+            chunk* next{_chunks->_next};
+            ::munmap(_chunks, _chunks->_size);
+            _chunks = next;
+        }
+        _cur       = nullptr;
+        _end       = nullptr;
+        _allocated = 0;
+    }
+
+    std::size_t allocated() const noexcept { return _allocated; }
+
+    bool owns(const void* p) const noexcept
+    {
+        for (chunk* c = _chunks; c; c = c->_next)
+            if (p >= static_cast<const void*>(c) && p < static_cast<const void*>(reinterpret_cast<char*>(c) + c->_size))
+                return true;
+        return false;
+    }
+
+private:
+    struct chunk
+    {
+        chunk*      _next;
+        std::size_t _size;
+    };
+
+    void new_chunk(std::size_t min_size)
+    {
+        std::size_t size{std::max(_chunk_size, min_size + sizeof(chunk))};
+        size = (size + page_size - 1) & ~(page_size - 1);
+        void* base{::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if (base == MAP_FAILED) throw std::bad_alloc{};
+
+        chunk* c{static_cast<chunk*>(base)};
+        c->_next = _chunks;
+        c->_size = size;
+        _chunks  = c;
+        _cur     = static_cast<char*>(base) + sizeof(chunk);
+        _end     = static_cast<char*>(base) + size;
+    }
+
+    tc_spin_lock _lock{0};
+    std::size_t  _chunk_size;
+    chunk*       _chunks{nullptr};
+    char*        _cur{nullptr};
+    char*        _end{nullptr};
+    std::size_t  _allocated{0};
+};
+
+// makes the arena current, for the allocations of the constructor running in its scope.
+class init_arena_scope
+{
+public:
+    explicit init_arena_scope(init_arena& arena) noexcept : _previous(std::exchange(current_init_arena, &arena)) {}
+    ~init_arena_scope() { current_init_arena = _previous; }
+    init_arena_scope(const init_arena_scope&) = delete;
+    init_arena_scope& operator=(const init_arena_scope&) = delete;
+
+private:
+    init_arena* _previous;
+};
+
+// std allocator bound to the current arena when default constructed, or to the heap when there is none.
+template<typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept : _arena(current_init_arena) {}
+    explicit arena_allocator(init_arena* arena) noexcept : _arena(arena) {}
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : _arena(other.arena())
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (_arena) return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        if (!_arena) ::operator delete(p);
+    }
+
+    init_arena* arena() const noexcept { return _arena; }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept
+    {
+        return _arena == other.arena();
+    }
+    template<typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept
+    {
+        return _arena != other.arena();
+    }
+
+private:
+    init_arena* _arena;
+};
+
+template<typename T>
+struct arena_release_only : std::false_type
+{
+};
+
+// the arena shared by the arena_singleton<T, Tag>(s) of one Tag.
+template<typename Tag>
+struct shared_init_arena : init_arena
+{
+};
+
+// T, constructed with its arena current, the arena (when not shared) released right after T's destructor.
+template<typename T, typename Tag = void>
+class arena_holder
+{
+public:
+    arena_holder() : _arena(select_arena())
+    {
+        init_arena_scope scope{_arena};
+        new (&_u._object) T{};
+    }
+    ~arena_holder()
+    {
+        if constexpr (!arena_release_only<T>::value) _u._object.~T();
+        _own.release();
+    }
+    arena_holder(const arena_holder&) = delete;
+    arena_holder& operator=(const arena_holder&) = delete;
+
+    T&          object() noexcept { return _u._object; }
+    init_arena& arena() noexcept { return _arena; }
+
+private:
+    init_arena& select_arena()
+    {
+        if constexpr (std::is_void_v<Tag>)
+            return _own;
+        else
+            return singleton<shared_init_arena<Tag>>::instance();  // constructed before, destroyed after this one
+    }
+
+    init_arena  _own;  // unused with a shared arena
+    init_arena& _arena;
+    union U
+    {
+        U() {}
+        ~U() {}
+        T _object;
+    } _u;
+};
+
+template<typename T, typename Tag = void, template<typename TT> class EI = early_initializer>
+class arena_singleton
+{
+    using holder_singleton = singleton<arena_holder<T, Tag>, EI>;
+
+public:
+    [[using gnu: hot]] static T& instance() { return holder_singleton::instance().object(); }
+    static init_arena&           arena() { return holder_singleton::instance().arena(); }
+};
+
+}  // namespace es::init
@@ -0,0 +1,309 @@
+//
+// keyed_singleton - one instance per key (venue, feed, account id), a lock free multiton.
+//
+// auto& feed{es::init::keyed_singleton<Feed, std::string>::instance("XNAS")};
+//
+// T is constructed from the key when it has such a constructor, otherwise default constructed. The first instance(key)
+// call of a key constructs its T exactly once, concurrent callers of the same key wait for it, callers of other keys
+// do not. Finding a constructed instance is wait free: the key's hash, a linear probe of an open addressing table of
+// atomic pointers, and a key comparison - no lock and no store.
+//
+// Every instance is constructed by singleton_publish(), like any other singleton - with its memory accounting, its init
+// arena scope and failure_policy_traits<T> (the failure is kept per key) - and is destroyed in reverse creation order,
+// between the singletons created before and after it. A constructor that throws leaves its key unconstructed, with
+// failure_policy::rethrow the next instance(key) tries again.
+// reset(key) destroys one instance, reset_all() all of them, the next instance(key) constructs a new one.
+// The table's entries are heap allocated, and freed by the table's own node on the destruction stack - pushed before
+// the first instance, it is popped after the last one is destroyed, at exit or by reset_all().
+//
+// The table has Capacity slots (a power of 2), it is not resized - an instance() of a new key in a full table throws
+// std::length_error. Keep the load below ~70% for short probes. The key must be copy constructible.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+#include <sched.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+namespace es::init {
+
+template<typename T, typename Key, typename Hash = std::hash<Key>, std::size_t Capacity = 1024,
+         typename KeyEqual = std::equal_to<Key>>
+class keyed_singleton
+{
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "keyed_singleton: Capacity is not a power of 2");
+
+    // constructing carries the fork generation in its upper bits, to recognize a construction by a parent's thread.
+    enum : uint32_t
+    {
+        unconstructed = 0,
+        constructing  = 1,
+        constructed   = 2,
+    };
+    static constexpr uint32_t state_mask{0x3U};
+
+    // its meta data is a base, the reset hook gets the entry back from the node on the destruction stack.
+    struct entry : singletons_meta_data
+    {
+        explicit entry(const Key& key) : singletons_meta_data{nullptr, nullptr, nullptr, 0, 0, {0}}, _key(key) {}
+
+        const Key                _key;
+        std::atomic<uint32_t>    _state{unconstructed};
+        std::atomic<const char*> _owner{nullptr};  // the constructing thread, to detect a circular dependency
+        union U
+        {
+            U() {}
+            ~U() {}
+            T _instance;
+        } _u;
+        failure_state _failure{failure_policy_traits<T>::value,
+                               failure_policy_traits<T>::initial_backoff_ms,
+                               failure_policy_traits<T>::max_backoff_ms,
+                               0,
+                               0,
+                               0,
+                               {}};
+        const singleton_ops _ops{construct_object, destroy_object, reset_entry, nullptr, &_u._instance, type_name(),
+                                 sizeof(T), account(), failure(_failure), 0};
+    };
+
+public:
+    [[using gnu: hot]] static T& instance(const Key& key)
+    {
+        entry* e{lookup(key)};
+        if (__builtin_expect(e->_state.load(std::memory_order_acquire) == constructed, 1)) return e->_u._instance;
+        return construct(*e);
+    }
+
+    // the instance of the key, nullptr when not constructed (yet), never constructs.
+    static T* find(const Key& key) noexcept
+    {
+        entry* e{find_entry(key)};
+        return e && e->_state.load(std::memory_order_acquire) == constructed ? &e->_u._instance : nullptr;
+    }
+
+    // destroys the key's instance, the next instance(key) constructs a new one, see reset_singleton().
+    static bool reset(const Key& key)
+    {
+        entry* e{find_entry(key)};
+        return e && e->_state.load(std::memory_order_acquire) == constructed && reset_singleton(*e);
+    }
+
+    // the number of keys in the table.
+    static std::size_t size() noexcept { return _size.load(std::memory_order_relaxed); }
+
+    // the constructions of all the keys, nullptr without memory_accounting.
+    static const memory_account* memory_usage() { return account(); }
+
+private:
+    static std::size_t hash(const Key& key) noexcept
+    {
+        // std::hash of integers is the identity, spread it over the table.
+        return static_cast<std::size_t>((static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    static entry* find_entry(const Key& key) noexcept
+    {
+        const std::size_t h{hash(key)};
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+            entry* e{_table[(h + i) & (Capacity - 1)].load(std::memory_order_acquire)};
+            if (!e || KeyEqual{}(e->_key, key)) return e;
+        }
+        return nullptr;
+    }
+
+    // the key's entry, inserted when not found.
+    static entry* lookup(const Key& key)
+    {
+        const std::size_t h{hash(key)};
+        entry*            inserted{nullptr};
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+            std::atomic<entry*>& slot{_table[(h + i) & (Capacity - 1)]};
+            entry*               e{slot.load(std::memory_order_acquire)};
+            if (!e)
+            {
+                if (!inserted) inserted = new entry(key);
+                if (slot.compare_exchange_strong(e, inserted, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    _size.fetch_add(1, std::memory_order_relaxed);
+                    return inserted;
+                }
+            }
+            if (KeyEqual{}(e->_key, key))  // found, or inserted by another thread first
+            {
+                delete inserted;
+                return e;
+            }
+        }
+        delete inserted;
+        throw std::length_error("keyed_singleton: the table is full");
+    }
+
+    [[using gnu: cold, noinline]] static T& construct(entry& e)
+    {
+        for (;;)
+        {
+            const uint32_t generation{fork_generation.load(std::memory_order_relaxed) << 2};
+            uint32_t       state{unconstructed};
+            if (e._state.compare_exchange_strong(state, constructing | generation, std::memory_order_acquire)) break;
+            if (state == constructed) return e._u._instance;
+            if ((state & ~state_mask) != generation)  // by a parent's thread, which does not exist after fork()
+            {
+                e._state.compare_exchange_strong(state, unconstructed, std::memory_order_relaxed);
+                continue;
+            }
+            if (e._owner.load(std::memory_order_relaxed) == &this_thread)
+                throw std::logic_error(std::string{"Error: circular dependency "} + type_name());
+            sched_yield();  // constructed by another thread
+        }
+        // the constructing state is the entry's lock, for its failure state too.
+        e._owner.store(&this_thread, std::memory_order_relaxed);
+        std::exception_ptr failure;
+        if (e._ops._failure && e._failure.blocked())
+            failure = e._failure._exception;
+        else
+        {
+            try
+            {
+                push_table();
+                publishing = &e;
+                singleton_publish(e, e._ops);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+                if (e._ops._failure) e._failure.record(failure);
+            }
+        }
+        e._owner.store(nullptr, std::memory_order_relaxed);
+        if (failure)
+        {
+            e._state.store(unconstructed, std::memory_order_release);
+            std::rethrow_exception(failure);
+        }
+        if (e._ops._failure) e._failure.clear();
+        e._state.store(constructed, std::memory_order_release);
+        return e._u._instance;
+    }
+
+    // singleton_ops::_construct, of the entry singleton_publish() is called for - read before T's constructor, which
+    // may construct another key.
+    static void construct_object()
+    {
+        static details_static_instances_counting::InstancesCounterZeroActivated<ActionOnZero> iCounter{};
+        entry& e{*publishing};
+        if constexpr (std::is_constructible_v<T, const Key&>)
+            new (&e._u._instance) T{e._key};
+        else
+            new (&e._u._instance) T{};
+    }
+
+    static void destroy_object(void* p) { static_cast<T*>(p)->~T(); }
+
+    // the table's node is pushed once, before the first instance is published.
+    static void push_table()
+    {
+        if (_table_pushed.load(std::memory_order_acquire)) return;
+        std::lock_guard<tc_spin_lock> guard(_table_node._lock);
+        if (_table_pushed.load(std::memory_order_relaxed)) return;
+        _table_node._p   = _table;
+        _table_node._ops = &table_ops;
+        stack::push(&_table_node);
+        _table_pushed.store(true, std::memory_order_release);
+    }
+
+    // the table's node _destroy, after all the instances - frees the entries.
+    static void free_entries(void*)
+    {
+        for (auto& slot : _table)
+            if (entry* e{slot.exchange(nullptr, std::memory_order_acq_rel)})
+            {
+                if (e->_ops._failure) failure_state::unlist(&e->_failure);
+                delete e;
+            }
+        _size.store(0, std::memory_order_relaxed);
+    }
+
+    // by reset_all(), the next instance() pushes the table's node again.
+    static void reset_table(singletons_meta_data&)
+    {
+        _table_node._next = nullptr;
+        _table_pushed.store(false, std::memory_order_release);
+    }
+
+    // after active_delete() by reset_singleton() or reset_all(), the destroyed entry becomes unconstructed.
+    static void reset_entry(singletons_meta_data& md)
+    {
+        entry& e{static_cast<entry&>(md)};
+        e._next       = nullptr;
+        e._init_count = 0;
+        e._flags      = 0;
+        if (e._ops._failure) e._failure.clear();
+        e._state.store(unconstructed, std::memory_order_release);
+    }
+
+    static constexpr const char* type_name() { return __PRETTY_FUNCTION__; }
+
+    // the account of all the keys, instantiated with memory_accounting only.
+    static constexpr memory_account* account()
+    {
+        if constexpr (memory_accounting)
+            return &_account;
+        else
+            return nullptr;
+    }
+
+    // the key's failure state, with retry_with_backoff and cache_failure only.
+    static failure_state* failure(failure_state& f)
+    {
+        return failure_policy_traits<T>::value != failure_policy::rethrow ? &f : nullptr;
+    }
+
+    inline static thread_local const char  this_thread{0};
+    inline static thread_local entry*      publishing{nullptr};
+    inline static std::atomic<entry*>      _table[Capacity];  // zero initialized
+    inline static std::atomic<std::size_t> _size;
+    inline static std::atomic<bool>        _table_pushed;
+    inline static singletons_meta_data     _table_node{nullptr, nullptr, nullptr, 0, 0, {0}};
+    inline static memory_account           _account{0, 0, sizeof(T)};
+
+    static constexpr singleton_ops table_ops{
+        nullptr, free_entries, reset_table, nullptr, _table, type_name(), sizeof(_table), nullptr, nullptr, 0};
+};
+
+}  // namespace es::init
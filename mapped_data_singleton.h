@@ -0,0 +1,169 @@
+//
+// mapped_data_singleton<Layout> - read-only, zero-copy view of a large immutable data file.
+//
+// The file is mapped read-only (MAP_POPULATE, MADV_WILLNEED) on the first access, and its header is validated - a
+// missing or invalid file throws std::runtime_error to that access. All the processes mapping the same file share the same page cache pages, instead of each parsing its own
+// heap copy. The mapping is a singleton, it is unmapped in the proper destruction order, after its dependents.
+//
+// The Layout describes the file:
+//
+// struct InstrumentsFile
+// {
+//     using header_type = InstrumentsHeader;             // at offset zero
+//     using record_type = Instrument;                    // array of records following the header
+//     static constexpr const char* arg_name{"instruments"};  // --instruments=<path> command line option
+//     static constexpr const char* env_name{"INSTRUMENTS"};  // or the environment variable
+//     static bool validate(const header_type& h, std::size_t records) { return h.magic == ... && h.count == records; }
+// };
+//
+// auto& instruments{es::init::mapped_data_singleton<InstrumentsFile>::instance()};
+//
+// mapped_data_singleton<InstrumentsFile, es::init::early_initializer> maps the file before main() - there, the
+// exception of a missing or invalid file is not caught, and the process terminates before main().
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <app_singletons.h>
+#include <fcntl.h>
+#include <singleton.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace es::init {
+
+template<typename Layout>
+class mapped_data
+{
+public:
+    using header_type = typename Layout::header_type;
+    using record_type = typename Layout::record_type;
+
+    static_assert(std::is_trivially_copyable_v<header_type> && std::is_trivially_copyable_v<record_type>,
+                  "mapped_data: header and records must be trivially copyable");
+
+    static constexpr std::size_t records_offset{(sizeof(header_type) + alignof(record_type) - 1) /
+                                                alignof(record_type) * alignof(record_type)};
+
+    mapped_data() : _path(find_path())
+    {
+        int fd{::open(_path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd < 0) throw_errno("open");
+
+        struct stat st{};
+        if (::fstat(fd, &st) < 0)
+        {
+            ::close(fd);
+            throw_errno("fstat");
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        if (_size < sizeof(header_type))
+        {
+            ::close(fd);
+            throw std::runtime_error("mapped_data: file too short for its header '" + _path + "'");
+        }
+
+        void* base{::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0)};
+        ::close(fd);
+        if (base == MAP_FAILED) throw_errno("mmap");
+        ::madvise(base, _size, MADV_WILLNEED);
+        _base = static_cast<const char*>(base);
+
+        if (!Layout::validate(header(), size()))
+        {
+            ::munmap(base, _size);
+            throw std::runtime_error("mapped_data: invalid header in '" + _path + "'");
+        }
+    }
+    ~mapped_data()
+    {
+        if (_base) ::munmap(const_cast<char*>(_base), _size);
+    }
+    mapped_data(const mapped_data&) = delete;
+    mapped_data& operator=(const mapped_data&) = delete;
+
+    const header_type& header() const { return *reinterpret_cast<const header_type*>(_base); }
+
+    std::size_t size() const { return _size > records_offset ? (_size - records_offset) / sizeof(record_type) : 0; }
+    const record_type* begin() const { return reinterpret_cast<const record_type*>(_base + records_offset); }
+    const record_type* end() const { return begin() + size(); }
+    const record_type& operator[](std::size_t i) const { return begin()[i]; }
+
+    const std::string& path() const { return _path; }
+
+private:
+    // command line option has precedence over the environment variable. Through instance(), the args and env
+    // references may not be bound yet when an early initialized mapped_data is constructed.
+    static const char* find_path()
+    {
+        const char* path{nullptr};
+        if constexpr (has_arg_name<Layout>::value) path = singleton<app_args>::instance().option(Layout::arg_name);
+        if constexpr (has_env_name<Layout>::value)
+            if (!path) path = singleton<app_env>::instance().get(Layout::env_name);
+        if (!path) throw std::runtime_error("mapped_data: no file path given for mapped data singleton");
+        return path;
+    }
+
+    [[noreturn]] void throw_errno(const char* what) const
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                std::string{"mapped_data: "} + what + " '" + _path + "'");
+    }
+
+    template<typename L, typename = void>
+    struct has_arg_name : std::false_type
+    {
+    };
+    template<typename L>
+    struct has_arg_name<L, std::void_t<decltype(L::arg_name)>> : std::true_type
+    {
+    };
+    template<typename L, typename = void>
+    struct has_env_name : std::false_type
+    {
+    };
+    template<typename L>
+    struct has_env_name<L, std::void_t<decltype(L::env_name)>> : std::true_type
+    {
+    };
+
+    std::string _path;
+    const char* _base{nullptr};
+    std::size_t _size{0};
+};
+
+template<typename Layout, template<typename TT> class EI = lazy_initializer>
+using mapped_data_singleton = singleton<mapped_data<Layout>, EI>;
+
+}  // namespace es::init
@@ -0,0 +1,146 @@
+//
+// memory_accounting - which singleton owns how much of the process memory.
+//
+// Build with -DINIT_SINGLETON_MEMORY_ACCOUNTING=1 and include this header in exactly one translation unit of the
+// program: it replaces the global operator new and delete, counting the heap bytes each thread holds - the
+// malloc_usable_size() of the blocks it allocated, less the blocks it freed. Every singleton construction is then
+// charged with the net bytes its thread allocated while its constructor ran (a temporary freed before the constructor
+// returns is not charged), and with its page faults (getrusage(RUSAGE_THREAD), times the page size). The constructions of the singletons
+// it depends on are nested in it, and are charged to their own accounts only.
+//
+// es::init::singleton<T>::memory_usage() is the account of T, report_singletons_stack() prints all the accounts,
+// next to sizeof(T):
+//
+// singletons_stack_meta_data_node[0]: ... object size: 64 heap bytes: 1048576 faulted bytes: 1060864 func name: ...
+//
+// Only operator new and delete are counted - malloc() calls of C libraries are in the faulted bytes only, once touched.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+
+#include <malloc.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static_assert(es::init::memory_accounting, "memory_accounting.h: build with -DINIT_SINGLETON_MEMORY_ACCOUNTING=1");
+
+namespace es::init::details_memory_accounting {
+
+// the block's usable size, on allocation and on release - the unsized operator delete does not know the requested one.
+inline void* counted(void* p) noexcept
+{
+    es::init::thread_heap_bytes += ::malloc_usable_size(p);
+    return p;
+}
+
+inline void* allocate(std::size_t size, std::size_t align) noexcept
+{
+    if (size == 0) size = 1;
+    if (align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return counted(std::malloc(size));
+    void* p{nullptr};
+    return ::posix_memalign(&p, align, size) ? nullptr : counted(p);
+}
+
+inline void release(void* p) noexcept
+{
+    es::init::thread_heap_bytes -= ::malloc_usable_size(p);
+    std::free(p);
+}
+
+inline void* allocate_or_throw(std::size_t size, std::size_t align)
+{
+    for (;;)
+    {
+        if (void* p{allocate(size, align)}) return p;
+        std::new_handler handler{std::get_new_handler()};
+        if (!handler) throw std::bad_alloc{};
+        handler();
+    }
+}
+
+}  // namespace es::init::details_memory_accounting
+
+void* operator new(std::size_t size)
+{
+    return es::init::details_memory_accounting::allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](std::size_t size)
+{
+    return es::init::details_memory_accounting::allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return es::init::details_memory_accounting::allocate_or_throw(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return es::init::details_memory_accounting::allocate_or_throw(size, static_cast<std::size_t>(align));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return es::init::details_memory_accounting::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return es::init::details_memory_accounting::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* p) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete[](void* p) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete[](void* p, std::size_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    es::init::details_memory_accounting::release(p);
+}
@@ -0,0 +1,87 @@
+//
+// once_function - a function with a one time set up, and no guard on its calls after that.
+//
+// once_function<Sig, Init, Fast>::call(args...) calls Init() once, on the first call, then Fast(args...). Like
+// singleton<T>::instance(), call() is an indirect call through an atomic pointer, which starts at a routine that runs
+// Init() and then points to Fast - the steady state call has no flag to check, no guard variable and no lock.
+//
+// static void build_crc_table();                       // fills crc_table[]
+// static uint32_t crc(const char* p, size_t n);       // reads crc_table[]
+// using crc32 = es::init::once_function<uint32_t(const char*, size_t), build_crc_table, crc>;
+// uint32_t c{crc32::call(p, n)};
+//
+// Init() runs in a singleton's constructor: concurrent first calls wait for the one running it, an Init() that calls
+// its own once_function is a circular dependency error. With EI = es::init::early_initializer it runs before main(),
+// and no call ever goes through the slow path. bind() runs it explicitly.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+
+#include <atomic>
+#include <utility>
+
+namespace es::init {
+
+template<typename Sig, auto Init, auto Fast, template<typename TT> class EI = lazy_initializer>
+class once_function;
+
+template<typename R, typename... Args, auto Init, auto Fast, template<typename TT> class EI>
+class once_function<R(Args...), Init, Fast, EI>
+{
+    using function_type = R (*)(Args...);
+    static_assert(std::is_convertible_v<decltype(Fast), function_type>, "once_function: Fast does not match Sig");
+
+    struct initializer
+    {
+        initializer()
+        {
+            Init();
+            _function.store(Fast, std::memory_order_release);
+        }
+    };
+
+    static R first_call(Args... arguments)
+    {
+        singleton<initializer, EI>::instance();
+        return Fast(std::forward<Args>(arguments)...);
+    }
+
+    inline static std::atomic<function_type> _function{first_call};
+
+public:
+    // acquire: Fast reads what Init wrote, a plain load on x86.
+    [[using gnu: hot]] static R call(Args... arguments)
+    {
+        return _function.load(std::memory_order_acquire)(std::forward<Args>(arguments)...);
+    }
+
+    static void bind() { singleton<initializer, EI>::instance(); }
+    static bool bound() noexcept { return _function.load(std::memory_order_acquire) != first_call; }
+};
+
+}  // namespace es::init
@@ -0,0 +1,177 @@
+//
+// Compile time declared singleton dependencies, and a single pre-main init routine in topological order.
+//
+// Without declarations, the dependencies are discovered at run time, by constructors calling instance(), and a cycle
+// is reported as std::logic_error by first_time_get_instance(). With declarations:
+//
+// using es::init::depends_on;
+// template<> struct es::init::singleton_dependencies<ComponentC> { using type = depends_on<ComponentD, ComponentE>; };
+// template<> struct es::init::singleton_dependencies<ComponentB> { using type = depends_on<ComponentC>; };
+//
+// ES_INIT_ORDERED_INIT(ComponentB)
+//
+// the order (ComponentD, ComponentE, ComponentC, ComponentB) is computed at compile time, a cycle fails the compilation
+// with a static_assert, and the singleton<T> objects are constructed in that order by one routine, which runs before
+// the early_initializer(s) - without the per singleton lock.
+// GCC ignores the constructor priority of a template's member function: an ordered_init<ComponentB> object alone runs
+// its routine among the early initializers, in link order - the singletons already constructed by them are skipped.
+// Dependencies that are not declared are still resolved at run time, by the regular instance() path, and a cycle
+// through them still throws std::logic_error.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+
+#include <type_traits>
+
+namespace es::init {
+
+// list of types, the declared dependencies of a singleton type, and the computed initialization order.
+template<typename... Ts>
+struct depends_on
+{
+};
+
+template<typename T>
+struct singleton_dependencies
+{
+    using type = depends_on<>;
+};
+
+namespace details_ordered {
+
+template<typename T, typename List>
+struct contains;
+template<typename T, typename... Ts>
+struct contains<T, depends_on<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)>
+{
+};
+
+template<typename List, typename T>
+struct append;
+template<typename... Ts, typename T>
+struct append<depends_on<Ts...>, T>
+{
+    using type = depends_on<Ts..., T>;
+};
+
+template<typename T>
+struct always_false : std::false_type
+{
+};
+
+// a list element: a type, accessed through singleton<T>, or its accessor, singleton<T, EI, M, InitT>, when the
+// program accesses it through another one - ordered_init<> constructs the instance that accessor returns.
+template<typename X>
+struct accessor
+{
+    using type       = singleton<X>;
+    using value_type = X;
+};
+template<typename T, template<typename TT> class EI, typename M, typename InitT>
+struct accessor<singleton<T, EI, M, InitT>>
+{
+    using type       = singleton<T, EI, M, InitT>;
+    using value_type = T;
+};
+
+// depth first, post order: all of T's dependencies are appended to Done before T.
+// Path holds the types being visited, T found on the Path is a cycle.
+template<typename T, typename Done, typename Path, bool Visited = contains<T, Done>::value,
+         bool InPath = contains<T, Path>::value>
+struct visit;
+
+template<typename Deps, typename Done, typename Path>
+struct visit_all;
+
+template<typename Done, typename Path>
+struct visit_all<depends_on<>, Done, Path>
+{
+    using type = Done;
+};
+template<typename D, typename... Ds, typename Done, typename Path>
+struct visit_all<depends_on<D, Ds...>, Done, Path>
+{
+    using type = typename visit_all<depends_on<Ds...>, typename visit<D, Done, Path>::type, Path>::type;
+};
+
+template<typename T, typename Done, typename Path, bool InPath>
+struct visit<T, Done, Path, true, InPath>
+{
+    using type = Done;
+};
+template<typename T, typename Done, typename Path>
+struct visit<T, Done, Path, false, true>
+{
+    static_assert(always_false<T>::value, "circular dependency in es::init::singleton_dependencies<>");
+    using type = Done;
+};
+template<typename T, typename Done, typename Path>
+struct visit<T, Done, Path, false, false>
+{
+    using type = typename append<
+        typename visit_all<typename singleton_dependencies<typename accessor<T>::value_type>::type, Done,
+                           typename append<Path, T>::type>::type,
+        T>::type;
+};
+
+}  // namespace details_ordered
+
+template<typename... Roots>
+using init_order_t = typename details_ordered::visit_all<depends_on<Roots...>, depends_on<>, depends_on<>>::type;
+
+template<typename... Roots>
+struct ordered_init
+{
+    // pre-main, see ES_INIT_ORDERED_INIT() - the priority is not applied to a template instantiation.
+    [[using gnu: used, constructor(200)]] static void init()
+    {
+        static bool done{false};  // pre-main, single threaded
+        if (done) return;
+        done = true;
+        construct(init_order_t<Roots...>{});
+    }
+
+private:
+    template<typename... Ts>
+    static void construct(depends_on<Ts...>)
+    {
+        (details_ordered::accessor<Ts>::type::ordered_construct(), ...);
+    }
+};
+
+}  // namespace es::init
+
+// ordered_init<Roots...>, from a plain function of the translation unit - its constructor priority, 200, is applied:
+// before the early_initializer(s) and the dynamic initialization of global objects.
+#define ES_INIT_ORDERED_INIT_FUNCTION(n) ES_INIT_ORDERED_INIT_FUNCTION_(n)
+#define ES_INIT_ORDERED_INIT_FUNCTION_(n) es_init_ordered_init_##n
+#define ES_INIT_ORDERED_INIT(...)                                                                                      \
+    [[using gnu: used, constructor(200)]] static void ES_INIT_ORDERED_INIT_FUNCTION(__COUNTER__)()                     \
+    {                                                                                                                  \
+        es::init::ordered_init<__VA_ARGS__>::init();                                                                   \
+    }
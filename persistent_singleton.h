@@ -0,0 +1,247 @@
+//
+// persistent_singleton<T, Path> - singleton stored in a memory mapped file, for warm restarts.
+//
+// On the first access (before main() with the default early_initializer) the file Path::path() is mapped.
+// If it holds a valid snapshot of T, with matching layout hash and version, the object is used as is - no constructor
+// is called, the restart cost is the mmap() and the page faults.
+// Otherwise T is constructed in a temporary file, marked valid once the construction completed, and renamed over
+// Path::path(): the processes that map the previous file keep their object, the file is never resized in place.
+// The mapping is shared, changes to the object are written back to the file, T's destructor is never called.
+//
+// T must be trivially copyable, or hold only position independent data (offsets instead of pointers), in which case
+// specialize es::init::is_persistable<T>.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <fcntl.h>
+#include <singleton.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace es::init {
+
+template<typename T>
+struct is_persistable : std::is_trivially_copyable<T>
+{
+};
+
+namespace details_persistent {
+
+inline uint64_t fnv1a(const char* s, uint64_t h = 0xcbf29ce484222325ULL) noexcept
+{
+    while (*s) h = (h ^ static_cast<unsigned char>(*s++)) * 0x100000001b3ULL;
+    return h;
+}
+
+inline uint64_t fnv1a(uint64_t v, uint64_t h) noexcept
+{
+    for (unsigned i = 0; i < sizeof(v); ++i, v >>= 8) h = (h ^ (v & 0xffU)) * 0x100000001b3ULL;
+    return h;
+}
+
+// type name based layout signature, the type name changes with the type's template arguments.
+template<typename T, uint64_t Version>
+uint64_t layout_hash() noexcept
+{
+    return fnv1a(Version, fnv1a(alignof(T), fnv1a(sizeof(T), fnv1a(__PRETTY_FUNCTION__))));
+}
+
+struct snapshot_header
+{
+    static constexpr uint64_t magic_value{0x544f4853504e5345ULL};  // "ESNPSHOT"
+
+    uint64_t _magic;
+    uint64_t _layout_hash;
+    uint64_t _object_offset;
+    uint64_t _object_size;
+    uint64_t _valid;  // set after T's construction completed and was written back
+};
+
+[[noreturn]] inline void throw_errno(const std::string& what, const char* path)
+{
+    throw std::system_error(errno, std::generic_category(), what + " '" + path + "'");
+}
+
+// the file at path, opened and locked - one builder at a time, when several processes start together.
+// A file replaced by another builder while waiting for its lock is opened again.
+inline int open_locked(const char* path)
+{
+    for (;;)
+    {
+        int fd{::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+        if (fd < 0) throw_errno("persistent_singleton: open", path);
+        struct stat locked{}, current{};
+        if (::flock(fd, LOCK_EX) < 0 || ::fstat(fd, &locked) < 0)
+        {
+            int e{errno};
+            ::close(fd);
+            errno = e;
+            throw_errno("persistent_singleton: lock", path);
+        }
+        if (::stat(path, &current) == 0 && current.st_dev == locked.st_dev && current.st_ino == locked.st_ino)
+            return fd;
+        ::close(fd);
+    }
+}
+
+}  // namespace details_persistent
+
+template<typename T, typename Path, uint64_t Version = 0, template<typename TT> class EI = early_initializer>
+class persistent_singleton
+{
+    static_assert(is_persistable<T>::value, "persistent_singleton<T>: T must be trivially copyable or is_persistable");
+
+    using header_type = details_persistent::snapshot_header;
+
+    static constexpr uint64_t object_align{alignof(T) > 64 ? alignof(T) : 64};
+    static constexpr uint64_t object_offset{(sizeof(header_type) + object_align - 1) / object_align * object_align};
+    static constexpr uint64_t file_size{object_offset + sizeof(T)};
+
+    class storage
+    {
+    public:
+        storage()
+        {
+            const char* path{Path::path()};
+            int         fd{details_persistent::open_locked(path)};
+
+            struct stat st{};
+            if (::fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) == file_size)
+            {
+                void* base{::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+                if (base != MAP_FAILED)
+                {
+                    map(base);
+                    const uint64_t hash{details_persistent::layout_hash<T, Version>()};
+                    _loaded = _header->_magic == header_type::magic_value && _header->_layout_hash == hash &&
+                              _header->_object_offset == object_offset && _header->_object_size == sizeof(T) &&
+                              _header->_valid;
+                    if (!_loaded) unmap();
+                }
+            }
+            try
+            {
+                if (!_loaded) build(path);
+            }
+            catch (...)
+            {
+                ::close(fd);  // and its lock
+                throw;
+            }
+            ::close(fd);
+        }
+        ~storage()
+        {
+            if (_header) ::munmap(_header, file_size);
+        }
+
+        header_type* _header{nullptr};
+        T*           _p{nullptr};
+        bool         _loaded{false};
+
+    private:
+        void map(void* base)
+        {
+            _header = static_cast<header_type*>(base);
+            _p      = reinterpret_cast<T*>(static_cast<char*>(base) + object_offset);
+        }
+        void unmap()
+        {
+            ::munmap(_header, file_size);
+            _header = nullptr;
+            _p      = nullptr;
+        }
+
+        // constructs T in a new file, renamed over path once valid, under path's lock.
+        void build(const char* path)
+        {
+            const std::string tmp{std::string{path} + ".tmp." + std::to_string(::getpid())};
+            int               fd{::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+            if (fd < 0) details_persistent::throw_errno("persistent_singleton: open", tmp.c_str());
+            void* base{::ftruncate(fd, file_size) < 0
+                           ? MAP_FAILED
+                           : ::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+            if (base == MAP_FAILED)
+            {
+                int e{errno};
+                ::close(fd);
+                ::unlink(tmp.c_str());
+                errno = e;
+                details_persistent::throw_errno("persistent_singleton: mmap", tmp.c_str());
+            }
+            ::close(fd);
+            map(base);
+            try
+            {
+                new (_p) T{};
+            }
+            catch (...)
+            {
+                unmap();
+                ::unlink(tmp.c_str());
+                throw;
+            }
+            _header->_magic         = header_type::magic_value;
+            _header->_layout_hash   = details_persistent::layout_hash<T, Version>();
+            _header->_object_offset = object_offset;
+            _header->_object_size   = sizeof(T);
+            ::msync(base, file_size, MS_SYNC);
+            _header->_valid = 1;
+            ::msync(base, file_size, MS_SYNC);
+            if (::rename(tmp.c_str(), path) < 0)
+            {
+                int e{errno};
+                unmap();
+                ::unlink(tmp.c_str());
+                errno = e;
+                details_persistent::throw_errno("persistent_singleton: rename", path);
+            }
+        }
+    };
+
+    static storage& get_storage() { return singleton<storage, EI>::instance(); }
+
+public:
+    [[using gnu: hot]] static T& instance() { return *get_storage()._p; }
+
+    // true if the object was mapped from a valid snapshot, false if it was constructed by this process.
+    static bool loaded_from_snapshot() { return get_storage()._loaded; }
+
+    // write the current object state to the file, and wait for completion.
+    static void sync() { ::msync(get_storage()._header, file_size, MS_SYNC); }
+};
+
+}  // namespace es::init
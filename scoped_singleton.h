@@ -0,0 +1,264 @@
+//
+// scoped_singleton - singletons per scope: a simulation run, a client session, an engine context.
+//
+// A singleton_scope<Scope> owns an init_arena, a destruction stack and a dense slot table. Made current in a thread
+// by a scope_guard, scoped_singleton<T, Scope>::instance() resolves to T of the current scope, constructed on its
+// first access in the scope, with the scope's arena current - T and its arena_allocator containers are allocated from
+// the arena. The dependencies T accesses from its constructor are constructed first, in the same scope.
+//
+// es::init::singleton_scope<Session> session;
+// es::init::scope_guard<Session>     current{session};
+// auto& book{es::init::scoped_singleton<OrderBook, Session>::instance()};
+//
+// Every scoped_singleton<T, Scope> type gets a slot index on its first use, a constructed instance is a load of the
+// current scope's table at that index. The scope's destructor destroys its instances in reverse creation order, with
+// the scope current, then releases the arena in one step. Construction in a scope is serialized by the scope's mutex,
+// a scope is destroyed when no thread uses it. An instance() without a current scope throws std::logic_error.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <init_arena.h>
+#include <singleton.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace es::init {
+
+// the type specific parts of a scoped_singleton<T>, constant.
+struct scoped_ops
+{
+    void (*_construct)(void*);  // construct T at the address
+    void (*_destroy)(void*);
+    const char* _name;
+    std::size_t _size;
+    std::size_t _align;
+};
+
+template<typename Scope>
+class scope_guard;
+
+template<typename Scope = void>
+class singleton_scope
+{
+public:
+    explicit singleton_scope(std::size_t chunk_size = 16 * 1024) : _arena(chunk_size)
+    {
+        std::size_t capacity{_slot_count.load(std::memory_order_relaxed) + 1};
+        _table.store(new_table(capacity < 16 ? 16 : capacity), std::memory_order_release);
+    }
+
+    // destroys the instances in reverse creation order, with this scope current, then releases the arena.
+    ~singleton_scope()
+    {
+        scope_guard<Scope> current{*this};
+        while (destruction_node* n{_destruction})
+        {
+            _destruction = n->_next;
+            ES_INIT_PROBE(destroy__begin, n->_ops->_name, n->_p, n->_ops->_size);
+            n->_ops->_destroy(n->_p);
+            ES_INIT_PROBE(destroy__end, n->_ops->_name, n->_p, n->_ops->_size);
+            _table.load(std::memory_order_relaxed)->slots()[n->_slot].store(nullptr, std::memory_order_relaxed);
+            --_size;
+        }
+    }
+    singleton_scope(const singleton_scope&) = delete;
+    singleton_scope& operator=(const singleton_scope&) = delete;
+
+    // the thread's current scope, nullptr when there is none.
+    static singleton_scope* current() noexcept { return _current; }
+
+    // the number of constructed instances.
+    std::size_t size() const noexcept { return _size; }
+
+    init_arena& arena() noexcept { return _arena; }
+
+    // the constructed instance of the slot in the current scope, nullptr when there is none.
+    [[using gnu: hot]] static void* lookup(uint32_t slot) noexcept
+    {
+        singleton_scope* s{_current};
+        if (!s) return nullptr;
+        slot_table* t{s->_table.load(std::memory_order_acquire)};
+        return slot < t->_capacity ? t->slots()[slot].load(std::memory_order_acquire) : nullptr;
+    }
+
+    // a new slot index, 0 is never assigned.
+    static uint32_t new_slot() noexcept { return _slot_count.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    // constructs the slot's instance once, with the scope's arena current.
+    [[using gnu: cold, noinline]] void* construct(uint32_t slot, const scoped_ops& ops)
+    {
+        std::lock_guard<std::recursive_mutex> guard(_mutex);
+
+        if (void* p{grow(slot)->slots()[slot].load(std::memory_order_relaxed)}) return p;
+        for (const construction* c = _constructing; c; c = c->_outer)
+            if (c->_slot == slot) throw std::logic_error(std::string{"Error: circular dependency "} + ops._name);
+
+        void*             p{_arena.allocate(ops._size, ops._align)};
+        destruction_node* n{new (_arena.allocate(sizeof(destruction_node), alignof(destruction_node)))
+                                destruction_node{nullptr, &ops, p, slot}};
+        {
+            construction     c{*this, slot};
+            init_arena_scope arena_scope{_arena};
+            ES_INIT_PROBE(construct__begin, ops._name, p, ops._size);
+            ops._construct(p);
+            ES_INIT_PROBE(construct__end, ops._name, p, ops._size);
+        }
+        n->_next     = _destruction;
+        _destruction = n;
+        ++_size;
+        _table.load(std::memory_order_relaxed)->slots()[slot].store(p, std::memory_order_release);  // grown, nested
+        return p;
+    }
+
+private:
+    friend class scope_guard<Scope>;
+
+    // _capacity slots follow the header.
+    struct slot_table
+    {
+        std::size_t         _capacity;
+        std::atomic<void*>* slots() noexcept { return reinterpret_cast<std::atomic<void*>*>(this + 1); }
+    };
+
+    struct destruction_node
+    {
+        destruction_node* _next;
+        const scoped_ops* _ops;
+        void*             _p;
+        uint32_t          _slot;
+    };
+
+    // the slots the thread is constructing, innermost first, under _mutex.
+    struct construction
+    {
+        construction(singleton_scope& s, uint32_t slot) noexcept : _s(s), _slot(slot), _outer(s._constructing)
+        {
+            s._constructing = this;
+        }
+        ~construction() { _s._constructing = _outer; }
+
+        singleton_scope&    _s;
+        uint32_t            _slot;
+        const construction* _outer;
+    };
+
+    slot_table* new_table(std::size_t capacity)
+    {
+        void* p{_arena.allocate(sizeof(slot_table) + capacity * sizeof(std::atomic<void*>), alignof(slot_table))};
+        slot_table* t{new (p) slot_table{capacity}};
+        for (std::size_t i = 0; i < capacity; ++i) new (&t->slots()[i]) std::atomic<void*>{nullptr};
+        return t;
+    }
+
+    // a slot type first used after the scope was created, the old table stays valid until the arena is released.
+    slot_table* grow(uint32_t slot)
+    {
+        slot_table* t{_table.load(std::memory_order_relaxed)};
+        if (slot < t->_capacity) return t;
+        std::size_t capacity{2 * t->_capacity};
+        while (capacity <= slot) capacity *= 2;
+        slot_table* grown{new_table(capacity)};
+        for (std::size_t i = 0; i < t->_capacity; ++i)
+            grown->slots()[i].store(t->slots()[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _table.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    init_arena               _arena;
+    std::atomic<slot_table*> _table{nullptr};
+    std::recursive_mutex     _mutex;
+    destruction_node*        _destruction{nullptr};  // newest first
+    const construction*      _constructing{nullptr};
+    std::size_t              _size{0};
+
+    inline static thread_local singleton_scope* _current{nullptr};
+    inline static std::atomic<uint32_t>         _slot_count{0};
+};
+
+// makes the scope current in this thread, restores the previous current scope at its end.
+template<typename Scope = void>
+class scope_guard
+{
+public:
+    explicit scope_guard(singleton_scope<Scope>& scope) noexcept
+        : _previous(std::exchange(singleton_scope<Scope>::_current, &scope))
+    {
+    }
+    ~scope_guard() { singleton_scope<Scope>::_current = _previous; }
+    scope_guard(const scope_guard&) = delete;
+    scope_guard& operator=(const scope_guard&) = delete;
+
+private:
+    singleton_scope<Scope>* _previous;
+};
+
+template<typename T, typename Scope = void>
+class scoped_singleton
+{
+public:
+    // T of the thread's current scope, std::logic_error without one.
+    [[using gnu: hot]] static T& instance()
+    {
+        void* p{singleton_scope<Scope>::lookup(_slot.load(std::memory_order_relaxed))};
+        if (__builtin_expect(p != nullptr, 1)) return *static_cast<T*>(p);
+        return construct();
+    }
+
+private:
+    [[using gnu: cold, noinline]] static T& construct()
+    {
+        singleton_scope<Scope>* s{singleton_scope<Scope>::current()};
+        if (!s) throw std::logic_error(std::string{"Error: no current scope "} + type_name());
+        return *static_cast<T*>(s->construct(slot(), ops));
+    }
+
+    // assigned on first use, not by a dynamic initializer that may run after an instance() call.
+    static uint32_t slot() noexcept
+    {
+        uint32_t s{_slot.load(std::memory_order_acquire)};
+        if (s) return s;
+        uint32_t n{singleton_scope<Scope>::new_slot()};
+        return _slot.compare_exchange_strong(s, n, std::memory_order_acq_rel) ? n : s;
+    }
+
+    static void construct_object(void* p) { new (p) T{}; }
+    static void destroy_object(void* p) { static_cast<T*>(p)->~T(); }
+    static constexpr const char* type_name() { return __PRETTY_FUNCTION__; }
+
+    static constexpr scoped_ops ops{construct_object, destroy_object, type_name(), sizeof(T), alignof(T)};
+
+    inline static std::atomic<uint32_t> _slot{0};  // 0 - not assigned yet
+};
+
+}  // namespace es::init
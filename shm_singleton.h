@@ -0,0 +1,256 @@
+//
+// shm_singleton<T, Name> - one instance of T shared by all the processes on the host, in POSIX shared memory.
+//
+// The first access creates or attaches the shm_open() segment Name::name(). The process winning the publish state
+// (empty -> constructing) constructs T, and publishes it (constructing -> published), the same handshake the atomic
+// _get_instance pointer does within a process. Attaching processes futex-wait until it is published.
+// The constructing state holds the constructor's pid, a waiter that finds that process gone takes over: it clears the
+// object's memory, drops the dead process's reference, and constructs T itself.
+// A segment of another size, created for another T or Version, is rejected before it is mapped.
+// The segment counts its attached processes, the last one to detach calls T's destructor and unlinks the segment.
+// A forked child attaches again (fork_policy::reinit_in_child), so it holds its own reference.
+//
+// T must not hold pointers to process local memory, lock-free structures of std::atomic<> values are a good fit.
+// A process that crashes after T is published keeps its reference, the segment outlives it.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <persistent_singleton.h>
+#include <singleton.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace es::init {
+
+namespace details_shm {
+
+enum : uint32_t
+{
+    state_empty        = 0,
+    state_constructing = 1,
+    state_published    = 2,
+    state_mask         = 3,
+};
+constexpr uint32_t attached_dead{~0U};  // the last process detached, the segment is being unlinked
+
+// state_constructing, tagged with the constructing process's pid (pid_max is at most 2^22).
+inline uint32_t constructing_by(pid_t pid) { return static_cast<uint32_t>(pid) << 2 | state_constructing; }
+inline pid_t    constructor_of(uint32_t state) { return static_cast<pid_t>(state >> 2); }
+inline bool     process_gone(pid_t pid) { return ::kill(pid, 0) < 0 && errno == ESRCH; }
+
+struct segment_header
+{
+    std::atomic<uint32_t> _state;
+    std::atomic<uint32_t> _attached;
+    uint64_t              _layout_hash;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "process shared atomics must be lock free");
+
+// shared (not FUTEX_PRIVATE) operations, the futex word is in memory mapped by several processes.
+// the wait is timed, the waiter checks the constructing process is still alive.
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t value)
+{
+    timespec timeout{0, 50'000'000};
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+[[noreturn]] inline void throw_errno(const char* what, const char* name)
+{
+    throw std::system_error(errno, std::generic_category(), std::string{"shm_singleton: "} + what + " '" + name + "'");
+}
+
+template<typename T, typename Name, uint64_t Version>
+class storage
+{
+    using header_type = segment_header;
+
+    static constexpr uint64_t object_align{alignof(T) > 64 ? alignof(T) : 64};
+    static constexpr uint64_t object_offset{(sizeof(header_type) + object_align - 1) / object_align * object_align};
+    static constexpr uint64_t segment_size{object_offset + sizeof(T)};
+
+public:
+    storage()
+    {
+        // retry when attaching to a segment that its last user is unlinking - after the destructor of its object, which
+        // may take a while, instead of spinning on shm_open() and mmap().
+        while (!attach(details_persistent::layout_hash<T, Version>()))
+        {
+            timespec pause{0, 1'000'000};
+            ::nanosleep(&pause, nullptr);
+        }
+    }
+    ~storage()
+    {
+        if (_header) detach();
+    }
+    storage(const storage&) = delete;
+    storage& operator=(const storage&) = delete;
+
+    header_type* _header{nullptr};
+    T*           _p{nullptr};
+
+private:
+    bool attach(uint64_t hash)
+    {
+        const char* name{Name::name()};
+        int         fd{::shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600)};
+        if (fd < 0) throw_errno("shm_open", name);
+        struct stat st{};
+        if (::fstat(fd, &st) < 0)
+        {
+            ::close(fd);
+            throw_errno("fstat", name);
+        }
+        // size a new segment only, zero filled - state_empty. Creators racing to size it set the same size.
+        if (st.st_size == 0 && (::ftruncate(fd, segment_size) < 0 || ::fstat(fd, &st) < 0))
+        {
+            ::close(fd);
+            throw_errno("ftruncate", name);
+        }
+        if (static_cast<uint64_t>(st.st_size) != segment_size)
+        {
+            ::close(fd);
+            throw std::runtime_error(std::string{"shm_singleton: segment size mismatch in '"} + name + "'");
+        }
+        void* base{::mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+        ::close(fd);
+        if (base == MAP_FAILED) throw_errno("mmap", name);
+
+        _header = static_cast<header_type*>(base);
+        _p      = reinterpret_cast<T*>(static_cast<char*>(base) + object_offset);
+
+        uint32_t n{_header->_attached.load()};
+        do
+        {
+            if (n == attached_dead)
+            {
+                ::munmap(base, segment_size);
+                _header = nullptr;
+                _p      = nullptr;
+                return false;
+            }
+        } while (!_header->_attached.compare_exchange_weak(n, n + 1));
+
+        for (uint32_t state{_header->_state.load(std::memory_order_acquire)}; state != state_published;
+             state = _header->_state.load(std::memory_order_acquire))
+        {
+            bool constructing{(state & state_mask) == state_constructing};
+            if (constructing && !process_gone(constructor_of(state)))
+            {
+                futex_wait(_header->_state, state);
+                continue;
+            }
+            if (!_header->_state.compare_exchange_strong(state, constructing_by(::getpid()))) continue;
+            if (constructing) drop_dead_constructor();
+            try
+            {
+                new (_p) T{};
+            }
+            catch (...)
+            {
+                _header->_state = state_empty;  // let another process try
+                futex_wake_all(_header->_state);
+                detach();
+                throw;
+            }
+            _header->_layout_hash = hash;
+            _header->_state.store(state_published, std::memory_order_release);
+            futex_wake_all(_header->_state);
+            return true;
+        }
+
+        if (_header->_layout_hash == hash) return true;
+        detach();
+        throw std::runtime_error(std::string{"shm_singleton: layout mismatch in '"} + name + "'");
+    }
+
+    // the constructing process died, the waiter that took over the construction drops its reference, and clears the
+    // partially constructed object.
+    void drop_dead_constructor()
+    {
+        std::memset(static_cast<void*>(_p), 0, sizeof(T));
+        uint32_t n{_header->_attached.load()};
+        while (!_header->_attached.compare_exchange_weak(n, n - 1))  // n > 1, this process is attached too
+            ;
+    }
+
+    void detach()
+    {
+        uint32_t n{_header->_attached.load()};
+        while (!_header->_attached.compare_exchange_weak(n, n == 1 ? attached_dead : n - 1))
+            ;
+        if (n == 1)
+        {
+            if (_header->_state.load(std::memory_order_acquire) == state_published) _p->~T();
+            ::shm_unlink(Name::name());
+        }
+        ::munmap(_header, segment_size);
+        _header = nullptr;
+        _p      = nullptr;
+    }
+};
+
+}  // namespace details_shm
+
+template<typename T, typename Name, uint64_t Version>
+struct fork_policy_traits<details_shm::storage<T, Name, Version>>
+{
+    static constexpr fork_policy value{fork_policy::reinit_in_child};
+};
+
+template<typename T, typename Name, uint64_t Version = 0, template<typename TT> class EI = early_initializer>
+class shm_singleton
+{
+    using storage_singleton = singleton<details_shm::storage<T, Name, Version>, EI>;
+
+public:
+    [[using gnu: hot]] static T& instance() { return *storage_singleton::instance()._p; }
+
+    // number of processes attached to the segment.
+    static uint32_t attached() { return storage_singleton::instance()._header->_attached.load(); }
+};
+
+}  // namespace es::init
@@ -50,13 +50,69 @@
 
 #pragma once
 
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
-#include <iostream>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <thread>
 #include <type_traits>
+#include <utility>
+#if defined(INIT_SINGLETON_IOSTREAM_INIT)
+#include <ios>
+#endif
+#if defined(INIT_SINGLETON_MEMORY_ACCOUNTING)
+#include <sys/resource.h>
+#endif
+#if defined(INIT_SINGLETON_ACCESS_COUNTING)
+#include <algorithm>
+#include <vector>
+#endif
+
+// Static tracepoints (USDT) of the singletons' life cycle, provider es_init, arguments: the func name (const char*),
+// the object's address and its size. An untraced probe is a nop instruction and a .note.stapsdt ELF note, which
+// perf, bpftrace and SystemTap list and attach to - e.g. bpftrace -e 'usdt:./app:es_init:construct__end { ... }'.
+// <sys/sdt.h> is used when available, otherwise the note is emitted here. INIT_SINGLETON_NO_PROBES removes them.
+#if defined(INIT_SINGLETON_NO_PROBES) || !defined(__ELF__) || !defined(__x86_64__)
+#define ES_INIT_PROBE(name, func_name, address, size) ((void)0)
+#elif __has_include(<sys/sdt.h>) && !defined(INIT_SINGLETON_BUNDLED_SDT)
+#include <sys/sdt.h>
+#define ES_INIT_PROBE(name, func_name, address, size) DTRACE_PROBE3(es_init, name, func_name, address, size)
+#else
+#define ES_INIT_PROBE(name, func_name, address, size)                                                                  \
+    __asm__ __volatile__("990: nop\n"                                                                                  \
+                         ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                                 \
+                         ".balign 4\n"                                                                                 \
+                         ".4byte 992f-991f, 994f-993f, 3\n"                                                            \
+                         "991: .asciz \"stapsdt\"\n"                                                                   \
+                         "992: .balign 4\n"                                                                            \
+                         "993: .8byte 990b\n"                                                                          \
+                         ".8byte _.stapsdt.base\n"                                                                     \
+                         ".8byte 0\n"                                                                                  \
+                         ".asciz \"es_init\"\n"                                                                        \
+                         ".asciz \"" #name "\"\n"                                                                      \
+                         ".asciz \"8@%0 8@%1 8@%2\"\n"                                                                 \
+                         "994: .balign 4\n"                                                                            \
+                         ".popsection\n"                                                                               \
+                         ".ifndef _.stapsdt.base\n"                                                                    \
+                         ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"                       \
+                         ".weak _.stapsdt.base\n"                                                                      \
+                         ".hidden _.stapsdt.base\n"                                                                    \
+                         "_.stapsdt.base: .space 1\n"                                                                  \
+                         ".size _.stapsdt.base, 1\n"                                                                   \
+                         ".popsection\n"                                                                               \
+                         ".endif\n"                                                                                    \
+                         :                                                                                             \
+                         : "nor"(reinterpret_cast<uintptr_t>(func_name)),                                              \
+                           "nor"(reinterpret_cast<uintptr_t>(address)), "nor"(static_cast<uint64_t>(size)))
+#endif
 
 namespace es::init {
 
@@ -71,17 +127,122 @@ constexpr const bool verbose_singletons
 #endif
 };
 
-static constexpr bool USE_BUILTIN_16B
+// attribute the allocations and the page faults of each singleton's construction to it, see memory_accounting.h
+constexpr const bool memory_accounting
 {
-#if defined(__GNUC__) && defined(__clang__)
-    false  // clang++ uses builtin for std::atomic<__int128>
-#elif defined(__GNUC__)
-    true  // enable the __sync... builtin functions instead of std::atomic<> that call atomic library.
+#if defined(INIT_SINGLETON_MEMORY_ACCOUNTING)
+    true
 #else
-    false  // other compilers
+    false
 #endif
 };
 
+// Diagnostics - the warnings and the verbose reports of the singletons, without a stream library dependency.
+// The sink gets one complete line, including its '\n'. It may be called before main() and after main() returns.
+using diagnostics_sink_t = void (*)(const char* line, std::size_t length);
+
+inline void stderr_diagnostics_sink(const char* line, std::size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n{::write(STDERR_FILENO, line, length)};
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        line += n;
+        length -= static_cast<std::size_t>(n);
+    }
+}
+
+inline std::atomic<diagnostics_sink_t> diagnostics_sink;  // do NOT initialize, nullptr - stderr_diagnostics_sink
+static_assert(std::is_trivially_constructible_v<std::atomic<diagnostics_sink_t>>,
+              "std::atomic should be trivially constructable");
+
+// returns the previous sink, nullptr restores the default.
+inline diagnostics_sink_t set_diagnostics_sink(diagnostics_sink_t sink) noexcept
+{
+    return diagnostics_sink.exchange(sink);
+}
+
+struct singletons_meta_data;
+
+// formats one line into a fixed buffer, emits it to the diagnostics sink (or to the given sink) from the destructor,
+// long lines are truncated.
+//   diagnostic{} << "Warning: " << name << " init count: " << n;
+class diagnostic
+{
+public:
+    diagnostic() noexcept = default;
+    explicit diagnostic(diagnostics_sink_t sink) noexcept : _sink(sink) {}
+    diagnostic(const diagnostic&) = delete;
+    diagnostic& operator=(const diagnostic&) = delete;
+    ~diagnostic()
+    {
+        _buf[_n++] = '\n';
+        auto sink  = _sink ? _sink : diagnostics_sink.load();
+        (sink ? sink : stderr_diagnostics_sink)(_buf, _n);
+    }
+
+    diagnostic& operator<<(std::string_view s) noexcept
+    {
+        for (char c : s) *this << c;
+        return *this;
+    }
+    diagnostic& operator<<(const char* s) noexcept { return *this << std::string_view{s ? s : "(null)"}; }
+    diagnostic& operator<<(char c) noexcept
+    {
+        if (_n < sizeof(_buf) - 1) _buf[_n++] = c;
+        return *this;
+    }
+    template<typename I, std::enable_if_t<std::is_integral_v<I>, int> = 0>
+    diagnostic& operator<<(I v) noexcept
+    {
+        unsigned long long u{static_cast<unsigned long long>(v)};
+        if constexpr (std::is_signed_v<I>)
+        {
+            if (v < 0)
+            {
+                *this << '-';
+                u = 0ULL - u;
+            }
+        }
+        return number(u, 10);
+    }
+    diagnostic& operator<<(const void* p) noexcept
+    {
+        *this << "0x";
+        return number(reinterpret_cast<uintptr_t>(p), 16);
+    }
+    inline diagnostic& operator<<(const singletons_meta_data& md) noexcept;
+
+private:
+    diagnostic& number(unsigned long long u, unsigned base) noexcept
+    {
+        char        digits[24];
+        std::size_t n{0};
+        do
+        {
+            digits[n++] = "0123456789abcdef"[u % base];
+            u /= base;
+        } while (u);
+        while (n) *this << digits[--n];
+        return *this;
+    }
+
+    diagnostics_sink_t _sink{nullptr};
+    char               _buf[512];
+    std::size_t        _n{0};
+};
+
+// std::ios_base::Init, when the singletons' constructors use std::cout / std::cerr before main(), opt-in by defining
+// INIT_SINGLETON_IOSTREAM_INIT, or by passing it as the InitT parameter of singleton<>.
+#if defined(INIT_SINGLETON_IOSTREAM_INIT)
+using default_init = ::std::ios_base::Init;
+#else
+struct default_init
+{
+};
+#endif
+
 namespace details_static_instances_counting {
 
 inline std::atomic<long> global_static_instances_counter;  // do NOT initialize, default zero
@@ -107,129 +268,326 @@ public:
         }
         if (global_static_instances_counter < 0)
         {
-            std::cerr << "Error: negative static counter:" << global_static_instances_counter << std::endl;
+            diagnostic{} << "Error: negative static counter:" << global_static_instances_counter.load();
         }
     }
     static long get_counter() noexcept { return global_static_instances_counter; }
 };
 }  // namespace details_static_instances_counting
 
-template<typename T>
-struct sequenced_ptr
+// Advanced in the child process after every fork(). A tc_spin_lock records the generation it was taken in, so a lock
+// held by a parent thread, which does not exist in the child, is recognized as stale and taken over.
+inline std::atomic<uint32_t> fork_generation;  // do NOT initialize, default zero
+static_assert(std::is_trivially_constructible_v<std::atomic<uint32_t>>,
+              "std::atomic should be trivially constructable");
+
+// Called first in the child process after fork(), before the singletons are reset and reinitialized - drops the
+// process wide state that refers to the parent's objects. A hook calls the one it replaced.
+using fork_child_hook_t = void (*)() noexcept;
+inline std::atomic<fork_child_hook_t> fork_child_hook;  // do NOT initialize, default nullptr
+
+// returns the previous hook.
+inline fork_child_hook_t set_fork_child_hook(fork_child_hook_t hook) noexcept
+{
+    return fork_child_hook.exchange(hook);
+}
+
+class tc_spin_lock
 {
-    union
+public:
+    void lock()
     {
-        uint128_t _unit;
-        struct
+        auto&          spinlock{*reinterpret_cast<std::atomic<uint32_t>*>(&_spinlock)};
+        const uint32_t owner{fork_generation.load(std::memory_order_relaxed) + 1};
+        uint32_t       b = 0;
+        while (!spinlock.compare_exchange_weak(b, owner))
         {
-            T*       _p;
-            uint64_t _seq;
-        } _s;
-    } _u;
-    sequenced_ptr load() noexcept
+            if (b == owner) b = 0;  // held in this process, wait for release; otherwise stale - take it over.
+        }
+    }
+    void unlock()
     {
-        if constexpr (USE_BUILTIN_16B)
-            return sequenced_ptr{__sync_val_compare_and_swap(&this->_u._unit, 0, 0)};
-        else
-            return sequenced_ptr{reinterpret_cast<std::atomic<uint128_t>*>(this)->load()};
+        auto& spinlock{*reinterpret_cast<std::atomic<uint32_t>*>(&_spinlock)};
+        spinlock.store(0, std::memory_order_release);
     }
-    bool cas(sequenced_ptr expected_value, const sequenced_ptr new_value)
+    // true when held by a thread of the current process (not a stale lock inherited over fork()).
+    bool is_locked() const
     {
-        if constexpr (USE_BUILTIN_16B)
-            return __sync_bool_compare_and_swap(&this->_u._unit, expected_value._u._unit, new_value._u._unit);
-        else
-            return reinterpret_cast<std::atomic<uint128_t>*>(this)->compare_exchange_strong(expected_value._u._unit,
-                                                                                            new_value._u._unit);
+        auto& spinlock{*reinterpret_cast<const std::atomic<uint32_t>*>(&_spinlock)};
+        return spinlock.load() == fork_generation.load(std::memory_order_relaxed) + 1;
     }
+
+    uint32_t _spinlock;
+    static_assert(sizeof(_spinlock) == sizeof(std::atomic<uint32_t>), "missmatching sizes");
+};
+static_assert(std::is_trivially_constructible_v<es::init::tc_spin_lock>,
+              "es::init::spin_lock is not trivially constructed");
+
+// What happens to a constructed singleton in the child process after fork():
+//  share           - the child uses the parent's object (copy-on-write pages), destroyed normally at the child's exit.
+//  reinit_in_child - the inherited object is abandoned (no destructor) and a fresh one is constructed in the child,
+//                    right after fork() returns, in the original creation order.
+//  drop_in_child   - the inherited object is abandoned (no destructor), a fresh one is constructed on first access.
+// Threads, locks and file descriptors owned by the parent's object are not valid in the child, such singletons should
+// use reinit_in_child or drop_in_child. Specialize fork_policy_traits<T> to select the policy of a type.
+// A reinit_in_child constructor that throws is reported, the singleton is then constructed on its first access.
+// A singleton, or a keyed_singleton key, another parent thread was constructing at fork() time is constructed by the
+// child on its first access. An shm_singleton construction in progress is completed by the parent's thread.
+enum class fork_policy : uint32_t
+{
+    share           = 0,
+    reinit_in_child = 1,
+    drop_in_child   = 2,
 };
-static_assert(sizeof(sequenced_ptr<int>) == 16, "Wrong size for sequenced_ptr");
 
-class alignas(64) tc_spin_lock
+template<typename T>
+struct fork_policy_traits
 {
-public:
-    void lock()
+    static constexpr fork_policy value{fork_policy::share};
+};
+
+// What happens when T's constructor throws, the exception always propagates to the accessing call:
+//  rethrow            - the singleton stays unconstructed, the next access calls the constructor again.
+//  retry_with_backoff - the accesses during the backoff rethrow the stored exception without calling the constructor.
+//                       The backoff starts at initial_backoff_ms and doubles after every failure up to max_backoff_ms.
+//  cache_failure      - the constructor is not called again, every access rethrows the stored exception.
+// Specialize failure_policy_traits<T> from failure_policy_config<> to select the policy of a type:
+// template<> struct es::init::failure_policy_traits<Daemon>
+//     : es::init::failure_policy_config<es::init::failure_policy::retry_with_backoff, 5, 2000> {};
+enum class failure_policy : uint32_t
+{
+    rethrow            = 0,
+    retry_with_backoff = 1,
+    cache_failure      = 2,
+};
+
+template<failure_policy Policy, uint32_t InitialBackoffMs = 10, uint32_t MaxBackoffMs = 10'000>
+struct failure_policy_config
+{
+    static constexpr failure_policy value{Policy};
+    static constexpr uint32_t       initial_backoff_ms{InitialBackoffMs};
+    static constexpr uint32_t       max_backoff_ms{MaxBackoffMs};
+};
+
+template<typename T>
+struct failure_policy_traits : failure_policy_config<failure_policy::rethrow>
+{
+};
+
+// CLOCK_MONOTONIC, in nanoseconds.
+inline int64_t monotonic_ns() noexcept
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000L + ts.tv_nsec;
+}
+
+using clock_ns_t = int64_t (*)() noexcept;
+
+inline std::atomic<clock_ns_t> backoff_clock;  // do NOT initialize, nullptr - monotonic_ns
+static_assert(std::is_trivially_constructible_v<std::atomic<clock_ns_t>>,
+              "std::atomic should be trivially constructable");
+
+// the clock of the retry_with_backoff policy, a test steps its own. Returns the previous clock.
+inline clock_ns_t set_backoff_clock(clock_ns_t clock) noexcept { return backoff_clock.exchange(clock); }
+
+inline int64_t backoff_now() noexcept
+{
+    auto clock = backoff_clock.load(std::memory_order_relaxed);
+    return clock ? clock() : monotonic_ns();
+}
+
+// the last construction failure of a singleton with retry_with_backoff or cache_failure, under its lock.
+struct failure_state
+{
+    failure_policy     _policy;
+    uint32_t           _initial_backoff_ms;
+    uint32_t           _max_backoff_ms;
+    uint32_t           _backoff_ms;
+    uint32_t           _failures;     // in a row
+    int64_t            _retry_at_ns;  // backoff_now()
+    std::exception_ptr _exception;    // cleared by a successful construction and by a reset
+    failure_state*     _next{nullptr};
+    bool               _listed{false};  // in failed, since the first failure
+
+    inline static failure_state* failed{nullptr};  // for reset_all()
+    inline static tc_spin_lock   failed_lock{0};
+
+    // true - rethrow _exception, do not call the constructor.
+    bool blocked() const noexcept
+    {
+        if (!_exception) return false;
+        return _policy == failure_policy::cache_failure || backoff_now() < _retry_at_ns;
+    }
+
+    void record(std::exception_ptr e) noexcept
     {
-        auto& spinlock{*reinterpret_cast<std::atomic<bool>*>(&_spinlock)};
-        bool  b = false;
-        while (spinlock.compare_exchange_strong(b, true))
+        _exception   = std::move(e);
+        _backoff_ms  = _failures++ ? 2 * _backoff_ms : _initial_backoff_ms;
+        _backoff_ms  = _backoff_ms < _max_backoff_ms ? _backoff_ms : _max_backoff_ms;
+        _retry_at_ns = backoff_now() + int64_t{_backoff_ms} * 1'000'000;
+        if (!_listed)
         {
-            b = false;
+            std::lock_guard<tc_spin_lock> guard(failed_lock);
+            _next   = failed;
+            failed  = this;
+            _listed = true;
         }
     }
-    void unlock()
+
+    void clear() noexcept
+    {
+        _exception = nullptr;
+        _failures  = 0;
+    }
+
+    static void clear_all() noexcept
     {
-        auto& spinlock{*reinterpret_cast<std::atomic<bool>*>(&_spinlock)};
-        spinlock = false;
+        std::lock_guard<tc_spin_lock> guard(failed_lock);
+        for (failure_state* f = failed; f; f = f->_next) f->clear();
     }
 
-    bool _spinlock;
-    static_assert(sizeof(_spinlock) == sizeof(std::atomic<bool>), "missmatching sizes");
+    // before the failure state is freed, see keyed_singleton.
+    static void unlist(failure_state* f) noexcept
+    {
+        if (!f->_listed) return;
+        std::lock_guard<tc_spin_lock> guard(failed_lock);
+        for (failure_state** p = &failed; *p; p = &(*p)->_next)
+            if (*p == f)
+            {
+                *p = f->_next;
+                break;
+            }
+        f->_listed = false;
+    }
 };
-static_assert(std::is_trivially_constructible_v<es::init::tc_spin_lock>,
-              "es::init::spin_lock is not trivially constructed");
 
 struct singleton_base
 {
 };
 
+// the memory a singleton's construction used, not including the constructions of the singletons it depends on.
+struct memory_account
+{
+    uint64_t _heap_bytes;     // allocated by operator new and not freed by operator delete during the construction
+    uint64_t _faulted_bytes;  // page faults, times the page size
+    uint64_t _object_size;    // sizeof(T), in the singleton's static storage
+};
+
+// the type specific parts of a singleton<T>, constant, passed to the type independent slow path.
+struct singleton_ops
+{
+    void (*_construct)();  // construct the object in its static storage
+    void (*_destroy)(void*);
+    void (*_reset)(singletons_meta_data&);  // make the destroyed (or abandoned) object of md unconstructed
+    void (*_create)();
+    void*           _p;           // the object's static storage
+    const char*     _name;        // __PRETTY_FUNCTION__ of a member of the singleton<T> - T and its parameters
+    std::size_t     _size;        // sizeof(T)
+    memory_account* _account;     // nullptr without memory_accounting
+    failure_state*  _failure;     // nullptr with failure_policy::rethrow
+    uint32_t        _fork_flags;  // fork_policy_traits<T>, shifted to its bits in singletons_meta_data::_flags
+};
+
+// The mutable per singleton state, 32 bytes, written only by its construction and destruction - the hot path reads
+// _get_instance and the object only. The type's functions, name and size are in its constant singleton_ops.
 struct singletons_meta_data
 {
     singletons_meta_data* _next;
-    void (*_func)();
-    void*        _p;
-    const char*  _func_name;
-    uint32_t     _init_count;
-    uint32_t     _flags;
-    tc_spin_lock _lock;
+    const singleton_ops*  _ops;  // nullptr until the first construction
+    void*                 _p;    // the constructed object, nullptr when not constructed
+    uint16_t              _init_count;
+    uint16_t              _flags;
+    tc_spin_lock          _lock;
+
+    static constexpr uint16_t fork_policy_shift{8};
+    static constexpr uint16_t fork_policy_mask{0x3U << fork_policy_shift};
+
+    const char* name() const noexcept { return _ops ? _ops->_name : "''"; }
+
+    fork_policy get_fork_policy() const
+    {
+        return static_cast<fork_policy>((_flags & fork_policy_mask) >> fork_policy_shift);
+    }
 };
 static_assert(std::is_trivially_constructible_v<singletons_meta_data>,
               "singletons_meta_data is not trivially constructed");
+static_assert(sizeof(singletons_meta_data) == 32, "singletons_meta_data is not compact");
 
-inline std::ostream& operator<<(std::ostream& os, const singletons_meta_data& md)
+inline diagnostic& diagnostic::operator<<(const singletons_meta_data& md) noexcept
+{
+    *this << "singleton meta data: " << (void*)&md << " p: " << (void*)md._p << " init count: " << md._init_count
+          << " flags: " << md._flags;
+    if (md._ops && md._ops->_account)
+        *this << " object size: " << md._ops->_size << " heap bytes: " << md._ops->_account->_heap_bytes
+              << " faulted bytes: " << md._ops->_account->_faulted_bytes;
+    return *this << " func name: " << md.name();
+}
+
+// any std::ostream like type, without including one here.
+template<typename OS>
+OS& operator<<(OS& os, const singletons_meta_data& md)
 {
     os << "singleton meta data: " << (void*)&md << " p: " << (void*)md._p << " init count: " << md._init_count
-       << " flags: " << md._flags << " func name: " << (md._func_name ? md._func_name : "''");
+       << " flags: " << md._flags;
+    if (md._ops && md._ops->_account)
+        os << " object size: " << md._ops->_size << " heap bytes: " << md._ops->_account->_heap_bytes
+           << " faulted bytes: " << md._ops->_account->_faulted_bytes;
+    os << " func name: " << md.name();
     return os;
 }
 
+// The destruction stack, of single word atomics - no 16 byte CAS, no -mcx16, no libatomic. Any thread pushes, a CAS
+// of the top, which has no ABA problem: the pushed node is not in the stack. Popping and removing run on one thread,
+// in empty_stack() at exit, reset_all() or reset(), concurrently with pushes only - a node they unlink is not pushed
+// again while they run, so the top they CAS cannot be an ABA recycled node either.
 template<typename T>
 struct static_obj_stack
 {
-    inline static sequenced_ptr<T> top{0UL};
+    static_assert(std::atomic<T*>::is_always_lock_free, "static_obj_stack: the top is not lock free");
+    inline static std::atomic<T*> top{nullptr};
 
     static void push(T* p)
     {
-        sequenced_ptr<T> stack_top;
-        sequenced_ptr<T> new_top;
+        T* stack_top{top.load(std::memory_order_relaxed)};
         do
         {
-            stack_top = top.load();
-            new_top   = stack_top;
-
-            p->_next         = stack_top._u._s._p;
-            new_top._u._s._p = p;
-            ++new_top._u._s._seq;
-        } while (!top.cas(stack_top, new_top));
+            p->_next = stack_top;
+        } while (!top.compare_exchange_weak(stack_top, p, std::memory_order_release, std::memory_order_relaxed));
     }
     static T* pop()
     {
-        sequenced_ptr<T> stack_top{};
-        sequenced_ptr<T> new_top{};
-        do
+        T* stack_top{top.load(std::memory_order_acquire)};
+        while (stack_top && !top.compare_exchange_weak(stack_top, stack_top->_next, std::memory_order_acquire))
         {
-            stack_top = top.load();
-            if (!stack_top._u._s._p) return nullptr;
-            new_top          = stack_top;
-            new_top._u._s._p = stack_top._u._s._p->_next;
-            ++new_top._u._s._seq;
-        } while (!top.cas(stack_top, new_top));
-        return stack_top._u._s._p;
+        }
+        return stack_top;
+    }
+    // unlinks p, false when it is not in the stack. Safe with concurrent push(), not with pop().
+    static bool remove(T* p)
+    {
+        for (;;)
+        {
+            T* stack_top{top.load(std::memory_order_acquire)};
+            if (stack_top == p)
+            {
+                if (top.compare_exchange_strong(stack_top, p->_next, std::memory_order_acquire)) return true;
+                continue;  // pushed over p
+            }
+            for (T* prev = stack_top; prev; prev = prev->_next)
+                if (prev->_next == p)
+                {
+                    prev->_next = p->_next;
+                    return true;
+                }
+            return false;
+        }
     }
 
     static uint64_t size()
     {
         uint64_t n{0};
-        for (T* p = top._u._s._p; p != nullptr; p = p->_next) ++n;
+        for (T* p = top.load(std::memory_order_acquire); p != nullptr; p = p->_next) ++n;
         return n;
     }
 };
@@ -239,6 +597,21 @@ static inline std::atomic<bool> clean_up_phase{false};
 static inline int               app_argc{0};
 static inline char**            app_argv{nullptr};
 
+[[using gnu: cold, noinline]] inline void active_delete(singletons_meta_data& md)
+{
+    std::lock_guard<tc_spin_lock> guard(md._lock);
+
+    if constexpr (es::init::verbose_singletons)
+    {
+        diagnostic{} << "active_delete - " << md;
+    }
+    [[maybe_unused]] const std::size_t size{md._ops ? md._ops->_size : 0};
+    ES_INIT_PROBE(destroy__begin, md.name(), md._p, size);
+    if (md._ops) md._ops->_destroy(md._p);
+    ES_INIT_PROBE(destroy__end, md.name(), md._p, size);
+    md._p = nullptr;
+}
+
 inline void empty_stack()
 {
     clean_up_phase = true;
@@ -248,35 +621,480 @@ inline void empty_stack()
     {
         if constexpr (es::init::verbose_singletons)
         {
-            std::cout << "empty_stack[" << n << "]: " << *p << std::endl;
+            diagnostic{} << "empty_stack[" << n << "]: " << *p;
             ++n;
         }
-        if (auto f = p->_func)
+        if (p->_p) active_delete(*p);
+    }
+}
+
+// destroys the singleton and makes it unconstructed, its next instance() constructs a new object.
+// false when it is not constructed. Not concurrently with the singleton's instance() or with empty_stack().
+inline bool reset_singleton(singletons_meta_data& md)
+{
+    if (!stack::remove(&md)) return false;
+    if (md._p) active_delete(md);
+    if (md._ops->_reset) md._ops->_reset(md);
+    return true;
+}
+
+// Destroys all the singletons in reverse creation order, as at exit, and makes them unconstructed - early initialized
+// ones included, their next instance() constructs a new object. For test suites: fresh singletons per test case, in one
+// process. No instance() call may run concurrently, and no reference to a singleton may be used after it.
+inline void reset_all()
+{
+    while (auto p = stack::pop())
+    {
+        if constexpr (es::init::verbose_singletons)
+        {
+            diagnostic{} << "reset_all: " << *p;
+        }
+        if (p->_p) active_delete(*p);
+        if (p->_ops && p->_ops->_reset) p->_ops->_reset(*p);
+    }
+    failure_state::clear_all();  // of the singletons that were never constructed
+}
+
+// pthread_atfork() child handler, runs in the single thread of the new child process, see fork_policy.
+inline void fork_child_handler()
+{
+    ++fork_generation;  // all the tc_spin_lock(s) held by the parent's threads become stale
+    if (auto hook = fork_child_hook.load(std::memory_order_relaxed)) hook();
+
+    singletons_meta_data*  kept{nullptr};
+    singletons_meta_data** kept_tail{&kept};
+    singletons_meta_data*  reinit{nullptr};
+
+    for (singletons_meta_data* p = stack::top.load(std::memory_order_relaxed); p != nullptr;)
+    {
+        auto next = p->_next;
+        switch (p->get_fork_policy())
+        {
+            case fork_policy::reinit_in_child:
+                p->_ops->_reset(*p);
+                p->_next = reinit;  // reversed - creation order
+                reinit   = p;
+                break;
+            case fork_policy::drop_in_child:
+                p->_ops->_reset(*p);
+                break;
+            default:
+                *kept_tail = p;
+                kept_tail  = &p->_next;
+                break;
+        }
+        p = next;
+    }
+    *kept_tail = nullptr;
+    stack::top.store(kept, std::memory_order_relaxed);
+
+    // an exception must not unwind through fork(): a failed reinit stays reset, constructed on its first access.
+    while (reinit)
+    {
+        auto next     = reinit->_next;
+        reinit->_next = nullptr;
+        try
+        {
+            reinit->_ops->_create();
+        }
+        catch (const std::exception& e)
+        {
+            diagnostic{} << "Error: reinit_in_child constructor exception: " << e.what() << " - " << reinit->name();
+        }
+        catch (...)
+        {
+            diagnostic{} << "Error: reinit_in_child constructor exception - " << reinit->name();
+        }
+        reinit = next;
+    }
+}
+
+inline void register_fork_handlers()
+{
+    static const bool registered{::pthread_atfork(nullptr, nullptr, fork_child_handler) == 0};
+    if (!registered) diagnostic{} << "Warning: pthread_atfork() failed, singletons are not fork aware";
+}
+
+class init_arena;
+
+// the allocation arena of the singleton this thread constructs, see init_arena.h. Each singleton's construction starts
+// without one, so a dependency constructed from a constructor does not allocate from its dependent's arena.
+inline thread_local init_arena* current_init_arena{nullptr};
+
+// heap bytes allocated less the bytes freed by this thread, counted by the operator new and delete of
+// memory_accounting.h - modulo 2^64, a thread may free blocks another one allocated.
+inline thread_local uint64_t thread_heap_bytes{0};
+
+#if defined(INIT_SINGLETON_MEMORY_ACCOUNTING)
+inline uint64_t thread_faulted_bytes() noexcept
+{
+    static const uint64_t page_size{static_cast<uint64_t>(::sysconf(_SC_PAGESIZE))};
+    struct rusage         usage
+    {
+    };
+    if (::getrusage(RUSAGE_THREAD, &usage)) return 0;
+    return static_cast<uint64_t>(usage.ru_minflt + usage.ru_majflt) * page_size;
+}
+
+// construct, charging the account with the thread's allocations and page faults during the construction, less the
+// ones of the nested singleton constructions, which are charged to their own accounts.
+[[using gnu: cold, noinline]] inline void accounted_construct(const singleton_ops& ops)
+{
+    static thread_local uint64_t nested_heap{0};
+    static thread_local uint64_t nested_faulted{0};
+
+    const uint64_t outer_heap{std::exchange(nested_heap, 0)};
+    const uint64_t outer_faulted{std::exchange(nested_faulted, 0)};
+    const uint64_t heap{thread_heap_bytes};
+    const uint64_t faulted{thread_faulted_bytes()};
+    try
+    {
+        ops._construct();
+    }
+    catch (...)
+    {
+        nested_heap    = outer_heap;
+        nested_faulted = outer_faulted;
+        throw;
+    }
+    const uint64_t heap_delta{thread_heap_bytes - heap};
+    const uint64_t faulted_delta{thread_faulted_bytes() - faulted};
+
+    ops._account->_heap_bytes += heap_delta - nested_heap;
+    ops._account->_faulted_bytes += faulted_delta - nested_faulted;
+    nested_heap    = outer_heap + heap_delta;
+    nested_faulted = outer_faulted + faulted_delta;
+}
+#endif
+
+// construct, and push to the destruction stack, without lock and checks.
+[[using gnu: cold, noinline]] inline void singleton_publish(singletons_meta_data& md, const singleton_ops& ops)
+{
+    [[maybe_unused]] const char* name{ops._name};
+    register_fork_handlers();
+    ES_INIT_PROBE(construct__begin, name, ops._p, ops._size);
+    {
+        // no current arena in the constructor, the caller's restored when it returns or throws.
+        struct arena_restore
+        {
+            ~arena_restore() { current_init_arena = _arena; }
+            init_arena* _arena{std::exchange(current_init_arena, nullptr)};
+        } restore;
+#if defined(INIT_SINGLETON_MEMORY_ACCOUNTING)
+        accounted_construct(ops);
+#else
+        ops._construct();
+#endif
+    }
+    ES_INIT_PROBE(construct__end, name, ops._p, ops._size);
+
+    if constexpr (es::init::verbose_singletons)
+    {
+        if (md._init_count > 0)
+            diagnostic{} << "Warning: 2 first_time_get_instance: initializing Singleton, more than once: init_count: "
+                         << md._init_count << " - " << name << " " << md;
+    }
+
+    md._p   = ops._p;
+    md._ops = &ops;
+    md._init_count++;
+    md._flags = static_cast<uint16_t>((md._flags & ~singletons_meta_data::fork_policy_mask) | ops._fork_flags);
+    stack::push(&md);
+}
+
+// the singletons the thread is constructing, innermost first - a singleton in it is a circular dependency, while a
+// singleton another thread is constructing is waited for.
+struct construction_frame
+{
+    explicit construction_frame(const singletons_meta_data& md) noexcept : _md(&md), _outer(innermost)
+    {
+        innermost = this;
+    }
+    ~construction_frame() { innermost = _outer; }
+    construction_frame(const construction_frame&) = delete;
+    construction_frame& operator=(const construction_frame&) = delete;
+
+    static bool constructing(const singletons_meta_data& md) noexcept
+    {
+        for (const construction_frame* f = innermost; f; f = f->_outer)
+            if (f->_md == &md) return true;
+        return false;
+    }
+
+    const singletons_meta_data* _md;
+    construction_frame*         _outer;
+    inline static thread_local construction_frame* innermost{nullptr};
+};
+
+// the slow path of the first instance() call(s) of every singleton type.
+[[using gnu: cold, noinline]] inline void singleton_construct(singletons_meta_data& md, const singleton_ops& ops)
+{
+    const char* name{ops._name};
+
+    if constexpr (es::init::verbose_singletons)
+    {
+        diagnostic{} << "Info: firstTimeGetInstance: initializing Singleton: " << name << " " << md;
+    }
+
+    if (clean_up_phase)
+    {
+        diagnostic{} << "Warning: initializing at clean up phase - " << name;
+    }
+
+    if (!md._p)
+    {
+        if ((md._flags & 0x1U) && construction_frame::constructing(md))
+        {
+            ES_INIT_PROBE(circular__dependency, name, ops._p, ops._size);
+            throw std::logic_error(std::string{"Error: circular dependency "} + name);
+        }
+        if (md._lock.is_locked()) ES_INIT_PROBE(lock__contention, name, ops._p, ops._size);
+        std::lock_guard<tc_spin_lock> guard(md._lock);
+
+        if (!md._p)
         {
-            p->_func = nullptr;
-            f();
+            if (md._init_count > 0)
+            {
+                diagnostic{} << "Warning: 1 first_time_get_instance: initializing Singleton, more than once: "
+                             << "init_count: " << md._init_count << " - " << name << " " << md;
+            }
+
+            if (ops._failure && ops._failure->blocked()) std::rethrow_exception(ops._failure->_exception);
+
+            construction_frame frame{md};
+            md._flags |= 0x1U;
+            try
+            {
+                singleton_publish(md, ops);
+            }
+            catch (...)
+            {
+                md._flags &= ~0x1U;  // unconstructed, not in progress
+                if (ops._failure) ops._failure->record(std::current_exception());
+                throw;
+            }
+            md._flags &= ~0x1U;
+            if (ops._failure) ops._failure->clear();
         }
     }
 }
 
+// ordered_init<>'s construction, pre-main and single threaded, without the lock - in progress and in a construction
+// frame, so a runtime cycle through a dependency not declared in singleton_dependencies<> throws.
+[[using gnu: cold, noinline]] inline void singleton_ordered_construct(singletons_meta_data& md, const singleton_ops& ops)
+{
+    construction_frame frame{md};
+    md._flags |= 0x1U;
+    try
+    {
+        singleton_publish(md, ops);
+    }
+    catch (...)
+    {
+        md._flags &= ~0x1U;
+        throw;
+    }
+    md._flags &= ~0x1U;
+}
+
 inline void report_singletons_stack()
 {
     uint64_t n{0};
-    for (singletons_meta_data* p = stack::top._u._s._p; p != nullptr; p = p->_next)
+    for (singletons_meta_data* p = stack::top.load(std::memory_order_acquire); p != nullptr; p = p->_next)
     {
-        std::cout << "singletons_stack_meta_data_node[" << n << "]: " << *p << std::endl;
+        diagnostic{} << "singletons_stack_meta_data_node[" << n << "]: " << *p;
         ++n;
     }
 }
 
-template<typename T>
-struct early_initializer_no_args
+#if defined(INIT_SINGLETON_ACCESS_COUNTING)
+// Access counting - the instance() calls of every singleton, counted per thread, and a sample of their call sites.
+// Without INIT_SINGLETON_ACCESS_COUNTING none of it is compiled, instance() is the plain indirect call.
+// Every INIT_SINGLETON_ACCESS_SAMPLING-th call of a thread (a power of 2, 0 - no sampling) records its return address,
+// the call site in the caller when instance() is inlined.
+#if !defined(INIT_SINGLETON_ACCESS_SAMPLING)
+#define INIT_SINGLETON_ACCESS_SAMPLING 1024
+#endif
+constexpr uint64_t access_sampling{INIT_SINGLETON_ACCESS_SAMPLING};
+static_assert((access_sampling & (access_sampling - 1)) == 0, "INIT_SINGLETON_ACCESS_SAMPLING is not a power of 2");
+
+// the accesses of one singleton type, and its sampled call sites.
+struct access_stats
 {
-    [[using gnu: used, constructor]] static void early_init()
+    static constexpr std::size_t max_sites{16};
+    struct site
     {
-        std::ios_base::Init z;
-        T::instance();
+        std::atomic<const void*> _caller{nullptr};
+        std::atomic<uint64_t>    _samples{0};
+    };
+
+    const singletons_meta_data* _md;
+    access_stats*               _next{nullptr};      // the registered types, under access_registry::_mutex
+    bool                        _registered{false};  // under the mutex
+    uint64_t                    _merged{0};          // the counts of exited threads and merged counters, under mutex
+    std::atomic<uint64_t>       _other_samples{0};   // of call sites beyond max_sites
+    site                        _sites[max_sites]{};
+};
+
+// one thread's counter of one singleton type, registered in the thread's access log on its first count.
+struct access_counter
+{
+    std::atomic<uint64_t> _count;  // written by its thread only
+    access_counter*       _next;
+    access_stats*         _stats;
+};
+
+class thread_access_log;
+
+struct access_registry
+{
+    inline static std::mutex         _mutex;
+    inline static access_stats*      _types{nullptr};
+    inline static thread_access_log* _threads{nullptr};
+};
+
+inline thread_local bool thread_access_log_destroyed{false};
+
+// the counters of a thread, merged to their access_stats when the thread exits.
+class thread_access_log
+{
+public:
+    thread_access_log()
+    {
+        std::lock_guard<std::mutex> guard(access_registry::_mutex);
+        _next                     = access_registry::_threads;
+        access_registry::_threads = this;
+    }
+    ~thread_access_log()
+    {
+        std::lock_guard<std::mutex> guard(access_registry::_mutex);
+        merge();
+        thread_access_log** p{&access_registry::_threads};
+        while (*p != this) p = &(*p)->_next;
+        *p                          = _next;
+        thread_access_log_destroyed = true;
     }
+    thread_access_log(const thread_access_log&) = delete;
+    thread_access_log& operator=(const thread_access_log&) = delete;
+
+    // under the mutex, by the log's thread.
+    void merge() noexcept
+    {
+        for (access_counter* c = _counters; c; c = c->_next)
+            c->_stats->_merged += c->_count.exchange(0, std::memory_order_relaxed);
+    }
+
+    access_counter*    _counters{nullptr};
+    thread_access_log* _next{nullptr};
+};
+
+inline thread_access_log* this_thread_access_log()
+{
+    if (thread_access_log_destroyed) return nullptr;
+    static thread_local thread_access_log log;
+    return &log;
+}
+
+[[using gnu: cold, noinline]] inline void register_access_counter(access_counter& c, access_stats& s)
+{
+    thread_access_log* log{this_thread_access_log()};
+    if (!log) return;  // after the thread's thread_local destructors, not counted
+    std::lock_guard<std::mutex> guard(access_registry::_mutex);
+    if (!s._registered)
+    {
+        s._next                 = access_registry::_types;
+        s._registered           = true;
+        access_registry::_types = &s;
+    }
+    c._stats       = &s;
+    c._next        = log->_counters;
+    log->_counters = &c;
+}
+
+[[using gnu: cold, noinline]] inline void sample_access_site(access_stats& s)
+{
+    const void* caller{__builtin_extract_return_addr(__builtin_return_address(0))};
+    for (auto& site : s._sites)
+    {
+        const void* p{nullptr};
+        if (site._caller.compare_exchange_strong(p, caller) || p == caller)
+        {
+            site._samples.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    s._other_samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+// the hot path: a thread local increment, no locked instruction.
+inline void count_access(access_counter& c, access_stats& s)
+{
+    const uint64_t n{c._count.load(std::memory_order_relaxed) + 1};
+    c._count.store(n, std::memory_order_relaxed);
+    if (__builtin_expect(c._stats == nullptr, 0)) register_access_counter(c, s);
+    if constexpr (access_sampling != 0)
+        if (__builtin_expect((n & (access_sampling - 1)) == 0, 0)) sample_access_site(s);
+}
+
+// moves the calling thread's counts to the totals, the counts of the other threads are read by singleton_accesses().
+inline void merge_thread_accesses()
+{
+    thread_access_log* log{this_thread_access_log()};
+    if (!log) return;
+    std::lock_guard<std::mutex> guard(access_registry::_mutex);
+    log->merge();
+}
+
+struct singleton_access
+{
+    const char*                                   _name;  // the func name of the singleton's meta data
+    uint64_t                                      _count;
+    std::vector<std::pair<const void*, uint64_t>> _sites;  // sampled call sites, most samples first
+};
+
+// the accesses of all the threads, the live ones included, hottest singleton first.
+inline std::vector<singleton_access> singleton_accesses()
+{
+    std::vector<singleton_access> result;
+    std::lock_guard<std::mutex>   guard(access_registry::_mutex);
+    for (access_stats* s = access_registry::_types; s; s = s->_next)
+    {
+        uint64_t count{s->_merged};
+        for (thread_access_log* t = access_registry::_threads; t; t = t->_next)
+            for (access_counter* c = t->_counters; c; c = c->_next)
+                if (c->_stats == s) count += c->_count.load(std::memory_order_relaxed);
+
+        singleton_access a{s->_md->name(), count, {}};
+        for (auto& site : s->_sites)
+            if (const void* caller{site._caller.load()})
+                a._sites.emplace_back(caller, site._samples.load(std::memory_order_relaxed));
+        if (uint64_t other{s->_other_samples.load(std::memory_order_relaxed)}) a._sites.emplace_back(nullptr, other);
+        std::sort(a._sites.begin(), a._sites.end(), [](auto& x, auto& y) { return x.second > y.second; });
+        result.push_back(std::move(a));
+    }
+    std::sort(result.begin(), result.end(), [](auto& x, auto& y) { return x._count > y._count; });
+    return result;
+}
+
+// the top singletons, and their top call sites (0x0 - the other sites), addr2line -fCe <program> resolves them.
+inline void report_singleton_accesses(std::size_t top = 10, std::size_t top_sites = 4)
+{
+    auto accesses{singleton_accesses()};
+    for (std::size_t i = 0; i < accesses.size() && i < top; ++i)
+    {
+        diagnostic{} << "singleton_accesses[" << i << "]: count: " << accesses[i]._count
+                     << " func name: " << accesses[i]._name;
+        for (std::size_t j = 0; j < accesses[i]._sites.size() && j < top_sites; ++j)
+            diagnostic{} << "    call site: " << accesses[i]._sites[j].first
+                         << " samples: " << accesses[i]._sites[j].second;
+    }
+}
+#endif
+
+template<typename T>
+struct early_initializer_no_args
+{
+    [[using gnu: used, constructor]] static void early_init() { T::instance(); }
 };
 
 template<typename T>
@@ -284,7 +1102,6 @@ struct early_initializer
 {
     [[using gnu: used, constructor]] static void early_init(int argc, char** argv)
     {
-        std::ios_base::Init z;
         if (es::init::app_argc != argc) es::init::app_argc = argc;
         if (es::init::app_argv != argv) es::init::app_argv = argv;
         T::instance();
@@ -303,90 +1120,83 @@ struct ActionOnZero
         static std::atomic<bool> activated{false};
 
         if constexpr (verbose_singletons)
-            std::cout << "ActionOnZero(): calling empty_stack(): from: " << __PRETTY_FUNCTION__ << "\n";
+            diagnostic{} << "ActionOnZero(): calling empty_stack(): from: " << __PRETTY_FUNCTION__;
         if (activated.exchange(true))
         {
-            std::cout << "ActionOnZero(): Already activated\n";
+            diagnostic{} << "ActionOnZero(): Already activated";
             return;
         }
         empty_stack();
     }
 };
 
+template<typename... Roots>
+struct ordered_init;
+
 template<typename T, template<typename TT> class EI = early_initializer, typename M = void,
-         typename InitT = ::std::ios_base::Init>
+         typename InitT = default_init>
 class singleton : public singleton_base, EI<singleton<T, EI, M, InitT>>
 {
-    static void active_delete()
-    {
-        std::lock_guard<tc_spin_lock> guard(singleton_meta_data_node._lock);
+    template<typename... Roots>
+    friend struct ordered_init;
 
-        static uint64_t active_delete_count{0};
-        ++active_delete_count;
-        if constexpr (es::init::verbose_singletons)
-        {
-            std::cerr << "active_delete - " << __PRETTY_FUNCTION__ << " " << (void*)singleton_meta_data_node._p << " "
-                      << active_delete_count << std::endl;
-        }
-        // call dtor, without releasing memory, which is statically allocated in the union.
-        static_cast<T*>(singleton_meta_data_node._p)->~T();
-        singleton_meta_data_node._p = nullptr;
+    // the type specific thunks, the type independent construction and destruction code is in singleton_construct() and
+    // active_delete() - one copy for all the singleton types.
+    static void construct_object()
+    {
+        static details_static_instances_counting::InstancesCounterZeroActivated<ActionOnZero> iCounter{};
+        new (&_u._instance) T{};
     }
 
-    static T& first_time_get_instance()
-    {
-        InitT init_object{};  // make sure, one can use the std::cout std::cerr streams from Singletons code
+    // call dtor, without releasing memory, which is statically allocated in the union.
+    static void destroy_object(void* p) { static_cast<T*>(p)->~T(); }
 
-        if constexpr (es::init::verbose_singletons)
-        {
-            std::cerr << "Info: firstTimeGetInstance: initializing Singleton: " << __PRETTY_FUNCTION__ << " "
-                      << singleton_meta_data_node << std::endl;
-        }
+    static void reset_instance(singletons_meta_data&)
+    {
+        singleton_meta_data_node._next       = nullptr;
+        singleton_meta_data_node._p          = nullptr;
+        singleton_meta_data_node._init_count = 0;
+        singleton_meta_data_node._flags      = 0;
+        if constexpr (failure() != nullptr) _failure_state.clear();
+        _get_instance = first_time_get_instance;
+    }
 
-        if (clean_up_phase)
-        {
-            std::cerr << "Warning: initializing at clean up phase - " << __PRETTY_FUNCTION__ << std::endl;
-        }
+    static void create_instance() { _get_instance.load()(); }
 
-        if (!singleton_meta_data_node._p)
-        {
-            if (singleton_meta_data_node._flags & 0x1U)
-            {
-                throw std::logic_error(std::string{"Error: circular dependency "} + __PRETTY_FUNCTION__);
-            }
-            std::lock_guard<tc_spin_lock> guard(singleton_meta_data_node._lock);
+    // the failure state, instantiated with retry_with_backoff and cache_failure only.
+    static constexpr failure_state* failure()
+    {
+        if constexpr (failure_policy_traits<T>::value != failure_policy::rethrow)
+            return &_failure_state;
+        else
+            return nullptr;
+    }
 
-            if (!singleton_meta_data_node._p)
-            {
-                if (singleton_meta_data_node._init_count > 0)
-                {
-                    std::cerr
-                        << "Warning: 1 first_time_get_instance: initializing Singleton, more than once: init_count: "
-                        << singleton_meta_data_node._init_count << " - " << __PRETTY_FUNCTION__ << " "
-                        << singleton_meta_data_node << std::endl;
-                }
+    // the diagnostics name, T and the singleton's parameters.
+    static constexpr const char* type_name() { return __PRETTY_FUNCTION__; }
 
-                singleton_meta_data_node._flags |= 0x1U;
-                static details_static_instances_counting::InstancesCounterZeroActivated<ActionOnZero> iCounter{};
-                new (&_u._instance) T{};
+    // the account, instantiated with memory_accounting only.
+    static constexpr memory_account* account()
+    {
+        if constexpr (memory_accounting)
+            return &_account;
+        else
+            return nullptr;
+    }
 
-                if constexpr (es::init::verbose_singletons)
-                {
-                    if (singleton_meta_data_node._init_count > 0)
-                        std::cerr << "Warning: 2 first_time_get_instance: initializing Singleton, more than once: "
-                                     "init_count: "
-                                  << singleton_meta_data_node._init_count << " - " << __PRETTY_FUNCTION__ << " "
-                                  << singleton_meta_data_node << std::endl;
-                }
+    // pre-main, single threaded construction in the compile time order of ordered_init<>, no lock.
+    static void ordered_construct()
+    {
+        if (singleton_meta_data_node._p) return;
+        [[maybe_unused]] InitT init_object{};
+        singleton_ordered_construct(singleton_meta_data_node, ops);
+        _get_instance = optimized_get_instance;
+    }
 
-                singleton_meta_data_node._func      = active_delete;
-                singleton_meta_data_node._p         = (void*)&_u._instance;
-                singleton_meta_data_node._func_name = __PRETTY_FUNCTION__;
-                singleton_meta_data_node._init_count++;
-                stack::push(&singleton_meta_data_node);
-                singleton_meta_data_node._flags &= ~0x1U;
-            }
-        }
+    static T& first_time_get_instance()
+    {
+        [[maybe_unused]] InitT init_object{};  // opt-in, see default_init
+        singleton_construct(singleton_meta_data_node, ops);
         _get_instance = optimized_get_instance;
 
         return _u._instance;
@@ -402,10 +1212,44 @@ class singleton : public singleton_base, EI<singleton<T, EI, M, InitT>>
         char _x;
         T    _instance;
     } _u;
-    inline static singletons_meta_data singleton_meta_data_node{nullptr, nullptr, nullptr, nullptr, 0, 0, {false}};
+    inline static singletons_meta_data singleton_meta_data_node{nullptr, nullptr, nullptr, 0, 0, {0}};
+    inline static memory_account _account{0, 0, sizeof(T)};
+    inline static failure_state  _failure_state{failure_policy_traits<T>::value,
+                                               failure_policy_traits<T>::initial_backoff_ms,
+                                               failure_policy_traits<T>::max_backoff_ms,
+                                               0,
+                                               0,
+                                               0,
+                                               {}};
+#if defined(INIT_SINGLETON_ACCESS_COUNTING)
+    inline static access_stats                _access_stats{&singleton_meta_data_node};
+    inline static thread_local access_counter _thread_accesses{};
+#endif
+    static constexpr singleton_ops ops{
+        construct_object, destroy_object, reset_instance, create_instance, &_u._instance, type_name(), sizeof(T),
+        account(), failure(),
+        static_cast<uint32_t>(fork_policy_traits<T>::value) << singletons_meta_data::fork_policy_shift};
 
 public:
-    [[using gnu: hot]] static T& instance() { return _get_instance.load()(); }
+    [[using gnu: hot]] static T& instance()
+    {
+#if defined(INIT_SINGLETON_ACCESS_COUNTING)
+        count_access(_thread_accesses, _access_stats);
+#endif
+        return _get_instance.load()();
+    }
+
+    // destroys T, the next instance() constructs a new one - see reset_singleton(). The singletons holding a reference
+    // to T should be reset too, or use reset_all().
+    static bool reset()
+    {
+        if (reset_singleton(singleton_meta_data_node)) return true;
+        if constexpr (failure() != nullptr) _failure_state.clear();  // a cached construction failure
+        return false;
+    }
+
+    // the memory T's construction used, nullptr without memory_accounting.
+    static const memory_account* memory_usage() { return account(); }
 };
 
 }  // namespace es::init
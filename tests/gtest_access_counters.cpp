@@ -0,0 +1,83 @@
+
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Hot
+{
+    int _value{1};
+};
+struct Cold
+{
+    int _value{2};
+};
+using hot  = es::init::singleton<Hot, es::init::lazy_initializer>;
+using cold = es::init::singleton<Cold, es::init::lazy_initializer>;
+
+static const es::init::singleton_access* find(const std::vector<es::init::singleton_access>& accesses, const char* type)
+{
+    for (auto& a : accesses)
+        if (std::string{a._name}.find(std::string{"T = "} + type + ";") != std::string::npos) return &a;
+    return nullptr;
+}
+
+static int sum(int n)
+{
+    int s{0};
+    for (int i = 0; i < n; ++i) s += hot::instance()._value;
+    return s;
+}
+
+static std::vector<std::string> lines;
+static void capture(const char* line, std::size_t length) { lines.emplace_back(line, length); }
+
+TEST(AccessCounters, counted_per_thread_and_merged)
+{
+    for (int i = 0; i < 3; ++i) cold::instance();
+    EXPECT_EQ(1000, sum(1000));
+
+    std::promise<void> counted;
+    std::promise<void> exit;
+    std::thread        t([&]() {
+        sum(1000);
+        counted.set_value();
+        exit.get_future().wait();
+    });
+    counted.get_future().wait();
+
+    auto live{es::init::singleton_accesses()};
+    ASSERT_NE(nullptr, find(live, "Hot"));
+    EXPECT_EQ(2000U, find(live, "Hot")->_count);  // includes the live thread's counter
+    EXPECT_EQ(3U, find(live, "Cold")->_count);
+    EXPECT_EQ(find(live, "Hot"), &live[0]);  // hottest first
+
+    exit.set_value();
+    t.join();
+    es::init::merge_thread_accesses();
+    auto merged{es::init::singleton_accesses()};
+    EXPECT_EQ(2000U, find(merged, "Hot")->_count);
+
+    // every 16-th call of each thread, from the loop in sum()
+    uint64_t samples{0};
+    for (auto& site : find(merged, "Hot")->_sites) samples += site.second;
+    EXPECT_EQ(2U * (1000 / 16), samples);
+    EXPECT_TRUE(find(merged, "Cold")->_sites.empty());
+}
+
+TEST(AccessCounters, report)
+{
+    hot::instance();
+    auto previous{es::init::set_diagnostics_sink(capture)};
+    es::init::report_singleton_accesses(1);
+    es::init::set_diagnostics_sink(previous);
+
+    ASSERT_LE(2U, lines.size());
+    EXPECT_NE(std::string::npos, lines[0].find("singleton_accesses[0]: count: ")) << lines[0];
+    EXPECT_NE(std::string::npos, lines[0].find("T = Hot;")) << lines[0];
+    EXPECT_NE(std::string::npos, lines[1].find("    call site: 0x")) << lines[1];
+}
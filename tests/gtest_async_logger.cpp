@@ -0,0 +1,121 @@
+
+#include <async_logger.h>
+//
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// an early singleton, constructed and destroyed while the logger is alive.
+struct Service
+{
+    Service() : _logger_was_active(es::init::async_logger::active() != nullptr) { es::init::log() << "Service()"; }
+    ~Service() { es::init::log() << "~Service() logger active: " << (es::init::async_logger::active() ? 1 : 0); }
+    bool _logger_was_active;
+};
+
+static std::string output;  // written by the logger's thread only
+
+static void capture_output(const char* lines, std::size_t length) { output.append(lines, length); }
+
+TEST(AsyncLogger, constructed_before_other_singletons)
+{
+    EXPECT_TRUE(es::init::singleton<Service>::instance()._logger_was_active);
+}
+
+TEST(AsyncLogger, lines_of_all_threads_in_order)
+{
+    auto& logger{es::init::logger::instance()};
+    logger.flush();
+    logger.set_output(capture_output);
+    output.clear();
+
+    constexpr int            threads{4};
+    constexpr int            lines{5000};  // more than the ring's slots
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; ++t)
+        producers.emplace_back([t]() {
+            for (int i = 0; i < lines; ++i) es::init::log() << "t" << t << " " << i;
+        });
+    for (auto& p : producers) p.join();
+    logger.flush();
+    logger.set_output(nullptr);
+
+    std::vector<int> next(threads, 0);
+    std::size_t      count{0};
+    for (std::size_t b = 0, e; (e = output.find('\n', b)) != std::string::npos; b = e + 1, ++count)
+    {
+        int t{0}, i{0};
+        ASSERT_EQ(2, sscanf(output.c_str() + b, "t%d %d", &t, &i));
+        ASSERT_EQ(next[t], i);  // per producer order is kept
+        ++next[t];
+    }
+    EXPECT_EQ(static_cast<std::size_t>(threads * lines), count);
+}
+
+// a line of the diagnostic buffer's length is longer than a slot, it is truncated and keeps its newline.
+TEST(AsyncLogger, long_lines_are_not_merged)
+{
+    auto& logger{es::init::logger::instance()};
+    logger.flush();
+    logger.set_output(capture_output);
+    output.clear();
+
+    const std::string a(510, 'a');
+    const std::string b(510, 'b');
+    es::init::log() << a;
+    es::init::log() << b;
+    logger.flush();
+    logger.set_output(nullptr);
+
+    auto end_a{output.find('\n')};
+    ASSERT_NE(std::string::npos, end_a);
+    EXPECT_LT(400U, end_a);
+    EXPECT_EQ(std::string(end_a, 'a'), output.substr(0, end_a));
+    EXPECT_EQ(std::string(end_a, 'b') + "\n", output.substr(end_a + 1));
+}
+
+TEST(AsyncLogger, library_diagnostics_are_queued)
+{
+    EXPECT_EQ(&es::init::async_logger::sink, es::init::diagnostics_sink.load());
+}
+
+TEST(AsyncLogger, destroyed_after_other_singletons)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");  // a fresh process, not a forked child
+    EXPECT_EXIT(
+        {
+            es::init::singleton<Service>::instance();
+            std::exit(0);
+        },
+        testing::ExitedWithCode(0), "~Service\\(\\) logger active: 1");
+}
+
+static es::init::fork_child_hook_t logger_fork_child_hook;
+static es::init::async_logger*     active_in_child_hook;
+
+static void record_active_logger() noexcept
+{
+    if (logger_fork_child_hook) logger_fork_child_hook();
+    active_in_child_hook = es::init::async_logger::active();
+}
+
+// before the singletons are reinitialized in the child, the parent's logger is not active.
+TEST(AsyncLogger, parent_logger_inactive_in_forked_child)
+{
+    es::init::logger::instance();
+    logger_fork_child_hook = es::init::set_fork_child_hook(record_active_logger);
+    active_in_child_hook   = es::init::async_logger::active();
+    pid_t pid{::fork()};
+    ASSERT_NE(-1, pid);
+    if (pid == 0) ::_exit(active_in_child_hook == nullptr && es::init::async_logger::active() != nullptr ? 0 : 1);
+    es::init::set_fork_child_hook(logger_fork_child_hook);
+    int status{0};
+    ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// the accessors gtest_codegen disassembles, defined in gtest_codegen_a.cpp and gtest_codegen_b.cpp.
+struct CodegenEarly
+{
+    int _value{1};
+};
+struct CodegenLazy
+{
+    int _value{2};
+};
+// constructed out of line, a function local static of it needs a guard.
+struct CodegenGuarded
+{
+    CodegenGuarded();
+    int _value;
+};
+
+extern "C" {
+CodegenEarly& codegen_early();
+CodegenEarly& codegen_early_b();  // the same singleton, from the second translation unit
+CodegenLazy&  codegen_lazy();
+long&         codegen_native();
+int           codegen_early_value();
+int           codegen_once(int);
+int           codegen_function_local_static();  // the contrast, not a singleton
+}
@@ -0,0 +1,206 @@
+
+#include "gtest_codegen.h"
+#include <once_function.h>
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The instance() steady state path, as compiled with this build's compiler and flags: the accessors are disassembled
+// from this executable, with objdump, and checked for their instruction count, conditional branches, guards and
+// atomic library calls. A failure prints the function's listing, the offending instructions marked.
+
+static int square(int x) { return x * x; }
+static void no_setup() {}
+
+using lazy_singleton = es::init::singleton<CodegenLazy, es::init::lazy_initializer>;
+using once_square    = es::init::once_function<int(int), no_setup, square>;
+
+extern "C" CodegenEarly& codegen_early() { return es::init::singleton<CodegenEarly>::instance(); }
+extern "C" CodegenLazy&  codegen_lazy() { return lazy_singleton::instance(); }
+extern "C" long&         codegen_native() { return es::init::singleton<long>::instance(); }
+extern "C" int           codegen_early_value() { return es::init::singleton<CodegenEarly>::instance()._value; }
+extern "C" int           codegen_once(int x) { return once_square::call(x); }
+extern "C" int           codegen_function_local_static()
+{
+    static CodegenGuarded guarded;
+    return guarded._value;
+}
+
+using listing = std::vector<std::string>;
+
+// the instructions of every function, by demangled name, without the alignment padding.
+static std::map<std::string, listing> disassemble()
+{
+    char        exe[4096]{};
+    ssize_t     n{::readlink("/proc/self/exe", exe, sizeof(exe) - 1)};
+    std::string command{"objdump -d --no-show-raw-insn -C " + std::string{exe, n > 0 ? std::size_t(n) : 0} +
+                        " 2>/dev/null"};
+
+    std::map<std::string, listing> functions;
+    FILE*                          p{::popen(command.c_str(), "r")};
+    if (!p) return functions;
+    listing* current{nullptr};
+    char     line[4096];
+    while (fgets(line, sizeof(line), p))
+    {
+        std::string l{line};
+        if (!l.empty() && l.back() == '\n') l.pop_back();
+        if (l.empty())
+            current = nullptr;
+        else if (l.size() > 3 && l.compare(l.size() - 2, 2, ">:") == 0 && l.find(" <") != std::string::npos)
+            current = &functions[l.substr(l.find(" <") + 2, l.size() - l.find(" <") - 4)];
+        else if (current && l.find(":\t") != std::string::npos)
+        {
+            std::string        instruction{l.substr(l.find(":\t") + 2)};
+            std::istringstream tokens{instruction};
+            std::string        mnemonic;
+            while (tokens >> mnemonic && (mnemonic == "cs" || mnemonic == "ds" || mnemonic == "data16"))
+            {
+            }
+            if (mnemonic.compare(0, 3, "nop") == 0 || mnemonic == "endbr64" || mnemonic == "int3" ||
+                instruction.compare(0, 14, "xchg   %ax,%ax") == 0)
+                continue;
+            current->push_back(instruction);
+        }
+    }
+    ::pclose(p);
+    return functions;
+}
+
+static const std::map<std::string, listing>& functions()
+{
+    static const std::map<std::string, listing> disassembled{disassemble()};
+    return disassembled;
+}
+
+// why the instruction is not allowed on the steady state path, empty when it is.
+static std::string violation(const std::string& instruction)
+{
+    std::string mnemonic{instruction.substr(0, instruction.find(' '))};
+    if (mnemonic[0] == 'j' && mnemonic != "jmp") return "conditional branch";
+    if (mnemonic == "loop" || mnemonic == "lock" || mnemonic == "mfence" || mnemonic.compare(0, 4, "xchg") == 0)
+        return "atomic or conditional instruction";
+    if (instruction.find("__cxa_guard") != std::string::npos) return "guard call";
+    if (instruction.find("__atomic_") != std::string::npos || instruction.find("__sync_") != std::string::npos)
+        return "libatomic call";
+    if ((mnemonic == "call" || mnemonic == "jmp") && instruction.find('*') == std::string::npos &&
+        instruction.find('<') != std::string::npos)
+        return "direct call";  // the only calls are through the accessor pointer
+    return "";
+}
+
+// the listing, the violations marked, empty when the code meets the budget and has no violation.
+static std::string check(const listing& code, std::size_t max_instructions)
+{
+    std::ostringstream diff;
+    bool               failed{code.size() > max_instructions};
+    for (auto& i : code)
+    {
+        std::string v{violation(i)};
+        failed |= !v.empty();
+        diff << (v.empty() ? "    " : "  > ") << i << (v.empty() ? "" : "    <-- " + v) << "\n";
+    }
+    if (!failed) return "";
+    return "instructions: " + std::to_string(code.size()) + ", expected at most " + std::to_string(max_instructions) +
+           "\n" + diff.str();
+}
+
+// the function named name, or name...suffix when suffix is given - a member of a template with long arguments.
+static const listing* find(const std::string& name, const std::string& suffix = "")
+{
+    if (suffix.empty())
+    {
+        auto f{functions().find(name)};
+        return f == functions().end() ? nullptr : &f->second;
+    }
+    for (auto& [function, code] : functions())
+        if (function.compare(0, name.size(), name) == 0 && function.size() >= name.size() + suffix.size() &&
+            function.compare(function.size() - suffix.size(), suffix.size(), suffix) == 0)
+            return &code;
+    return nullptr;
+}
+
+class Codegen : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+#if !defined(__x86_64__)
+        GTEST_SKIP() << "x86-64 only";
+#endif
+        if (functions().empty()) GTEST_SKIP() << "objdump is not available";
+    }
+
+    static void expect(const std::string& function, std::size_t max_instructions, const std::string& suffix = "")
+    {
+        const listing* code{find(function, suffix)};
+        ASSERT_NE(nullptr, code) << function << " not found";
+        ASSERT_FALSE(code->empty()) << function;
+        std::string failure{check(*code, max_instructions)};
+        EXPECT_TRUE(failure.empty()) << function << suffix << ":\n" << failure;
+    }
+};
+
+TEST_F(Codegen, accessors_are_a_load_and_an_indirect_jump)
+{
+    expect("codegen_early", 2);
+    expect("codegen_lazy", 2);
+    expect("codegen_native", 2);
+    expect("codegen_early_b", 2);
+    expect("codegen_once", 2);
+}
+
+TEST_F(Codegen, inlined_access)
+{
+    expect("codegen_early_value", 6);
+}
+
+TEST_F(Codegen, optimized_get_instance_returns_the_address)
+{
+    expect("es::init::singleton<CodegenEarly,", 2, "::optimized_get_instance()");
+    expect("es::init::singleton<long,", 2, "::optimized_get_instance()");
+}
+
+// the destruction stack push in the construction slow path: a single word CAS, no cmpxchg16b, no libatomic.
+TEST_F(Codegen, destruction_stack_push_is_a_single_word_cas)
+{
+    const listing* code{find("es::init::singleton_publish(", ")")};
+    ASSERT_NE(nullptr, code);
+    std::string listed;
+    bool        cas{false};
+    for (auto& i : *code)
+    {
+        listed += "    " + i + "\n";
+        cas |= i.compare(0, 4, "lock") == 0 && i.find("cmpxchg ") != std::string::npos;
+        EXPECT_EQ(std::string::npos, i.find("cmpxchg16b")) << i;
+        EXPECT_EQ(std::string::npos, i.find("__atomic_")) << i;
+        EXPECT_EQ(std::string::npos, i.find("__sync_")) << i;
+    }
+    EXPECT_TRUE(cas) << "es::init::singleton_publish():\n" << listed;
+}
+
+// the checker finds the guard of a function local static.
+TEST_F(Codegen, function_local_static_has_a_guard)
+{
+    const listing* code{find("codegen_function_local_static")};
+    ASSERT_NE(nullptr, code);
+    EXPECT_NE("", check(*code, 100));
+}
+
+TEST_F(Codegen, one_instance_across_translation_units)
+{
+    EXPECT_EQ(&codegen_early(), &codegen_early_b());
+    EXPECT_EQ(1, codegen_early_value());
+    EXPECT_EQ(2, codegen_lazy()._value);
+    EXPECT_EQ(0, codegen_native());
+    EXPECT_EQ(9, codegen_once(3));
+    EXPECT_EQ(3, codegen_function_local_static());
+}
@@ -0,0 +1,7 @@
+
+#include "gtest_codegen.h"
+#include <singleton.h>
+
+extern "C" CodegenEarly& codegen_early_b() { return es::init::singleton<CodegenEarly>::instance(); }
+
+CodegenGuarded::CodegenGuarded() : _value(3) {}
@@ -0,0 +1,108 @@
+
+#include <cpu_dispatch.h>
+//
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+
+using es::init::simd_tier;
+
+// the sum of the bytes, tagged with the tier that computed it.
+static long sum_scalar(const unsigned char* p, std::size_t n)
+{
+    long s{0};
+    for (std::size_t i = 0; i < n; ++i) s += p[i];
+    return s * 10 + 0;
+}
+[[gnu::target("sse4.2")]] static long sum_sse42(const unsigned char* p, std::size_t n)
+{
+    long s{0};
+    for (std::size_t i = 0; i < n; ++i) s += p[i];
+    return s * 10 + 1;
+}
+[[gnu::target("avx2")]] static long sum_avx2(const unsigned char* p, std::size_t n)
+{
+    long s{0};
+    for (std::size_t i = 0; i < n; ++i) s += p[i];
+    return s * 10 + 2;
+}
+
+using sum = es::init::dispatch_function<long(const unsigned char*, std::size_t),
+                                        es::init::simd_impl<simd_tier::scalar, sum_scalar>,
+                                        es::init::simd_impl<simd_tier::sse42, sum_sse42>,
+                                        es::init::simd_impl<simd_tier::avx2, sum_avx2>>;
+
+struct Codec
+{
+    virtual ~Codec() = default;
+    virtual const char* name() const = 0;
+};
+struct ScalarCodec : Codec
+{
+    static constexpr simd_tier tier{simd_tier::scalar};
+    const char*                name() const override { return "scalar"; }
+};
+struct Avx512Codec : Codec
+{
+    static constexpr simd_tier tier{simd_tier::avx512};
+    const char*                name() const override { return "avx512"; }
+};
+using codec = es::init::dispatch_singleton<Codec, ScalarCodec, Avx512Codec>;
+
+TEST(CpuDispatch, detected)
+{
+    auto& features{es::init::cpu_features_singleton::instance()};
+    EXPECT_LE(features.tier(), features.detected());
+    EXPECT_EQ(features.detected(), es::init::cpu_features::detect());
+
+    simd_tier tier{simd_tier::scalar};
+    EXPECT_TRUE(es::init::cpu_features::parse("avx2", tier));
+    EXPECT_EQ(simd_tier::avx2, tier);
+    EXPECT_FALSE(es::init::cpu_features::parse("neon", tier));
+    EXPECT_STREQ("sse4.2", es::init::to_string(simd_tier::sse42));
+}
+
+TEST(CpuDispatch, select_the_highest_supported)
+{
+    using es::init::simd_impl;
+    using scalar_avx2 = es::init::dispatch_function<long(const unsigned char*, std::size_t),
+                                                    simd_impl<simd_tier::avx2, sum_avx2>,
+                                                    simd_impl<simd_tier::scalar, sum_scalar>>;
+    EXPECT_EQ(1U, (es::init::select_impl<simd_impl<simd_tier::avx2, sum_avx2>,
+                                         simd_impl<simd_tier::scalar, sum_scalar>>(simd_tier::sse42)));
+    EXPECT_EQ(0U, (es::init::select_impl<simd_impl<simd_tier::avx2, sum_avx2>,
+                                         simd_impl<simd_tier::scalar, sum_scalar>>(simd_tier::avx512)));
+    const bool avx2{es::init::cpu_features_singleton::instance().tier() >= simd_tier::avx2};
+    EXPECT_EQ(avx2 ? simd_tier::avx2 : simd_tier::scalar, scalar_avx2::tier());
+}
+
+TEST(CpuDispatch, function)
+{
+    const unsigned char data[]{1, 2, 3, 4};
+    const simd_tier     expected{std::min(simd_tier::avx2, es::init::cpu_features_singleton::instance().tier())};
+    EXPECT_EQ(expected, sum::tier());
+    EXPECT_EQ(100 + static_cast<long>(expected), sum::call(data, sizeof(data)));
+}
+
+TEST(CpuDispatch, object)
+{
+    const bool avx512{es::init::cpu_features_singleton::instance().tier() == simd_tier::avx512};
+    EXPECT_STREQ(avx512 ? "avx512" : "scalar", codec::instance().name());
+    EXPECT_EQ(avx512 ? simd_tier::avx512 : simd_tier::scalar, codec::tier());
+}
+
+static bool dispatched_to_scalar()
+{
+    const unsigned char data[]{1, 2, 3, 4};
+    return es::init::cpu_features_singleton::instance().tier() == simd_tier::scalar &&
+           sum::call(data, sizeof(data)) == 100 && !std::strcmp(codec::instance().name(), "scalar");
+}
+
+TEST(CpuDispatch, forced_tier)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");  // a fresh process, with the variable set before main()
+    ::setenv("ES_INIT_SIMD_TIER", "scalar", 1);
+    EXPECT_EXIT(std::exit(dispatched_to_scalar() ? 0 : 1), testing::ExitedWithCode(0), "");
+    ::unsetenv("ES_INIT_SIMD_TIER");
+}
@@ -0,0 +1,124 @@
+
+#include <cpu_topology.h>
+//
+#include <gtest/gtest.h>
+//
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using es::init::cpu_topology;
+
+static void write_file(const std::string& path, const std::string& content)
+{
+    std::string dir{path.substr(0, path.rfind('/'))};
+    std::string mkdir{"mkdir -p " + dir};
+    ASSERT_EQ(0, std::system(mkdir.c_str()));
+    FILE* f{fopen(path.c_str(), "w")};
+    ASSERT_NE(nullptr, f);
+    fputs(content.c_str(), f);
+    fclose(f);
+}
+
+// 2 packages (NUMA nodes) x 2 cores x 2 SMT threads, Linux numbering: cpu<N> and cpu<N+4> are siblings.
+static std::string synthetic_topology()
+{
+    std::string root{"/tmp/gtest_cpu_topology." + std::to_string(::getpid())};
+    std::string cpu{root + "/sys/devices/system/cpu/"};
+    write_file(cpu + "online", "0-7\n");
+    for (unsigned n = 0; n < 8; ++n)
+    {
+        std::string dir{cpu + "cpu" + std::to_string(n) + "/"};
+        unsigned    first{n % 4};
+        write_file(dir + "topology/physical_package_id", std::to_string(first / 2) + "\n");
+        write_file(dir + "topology/core_id", std::to_string(first % 2) + "\n");
+        write_file(dir + "topology/thread_siblings_list",
+                   std::to_string(first) + "," + std::to_string(first + 4) + "\n");
+        write_file(dir + "cache/index0/level", "1\n");
+        write_file(dir + "cache/index0/type", "Data\n");
+        write_file(dir + "cache/index0/size", "48K\n");
+        write_file(dir + "cache/index1/level", "1\n");
+        write_file(dir + "cache/index1/type", "Instruction\n");
+        write_file(dir + "cache/index1/size", "32K\n");
+        write_file(dir + "cache/index2/level", "2\n");
+        write_file(dir + "cache/index2/type", "Unified\n");
+        write_file(dir + "cache/index2/size", "2048K\n");
+        write_file(dir + "cache/index3/level", "3\n");
+        write_file(dir + "cache/index3/type", "Unified\n");
+        write_file(dir + "cache/index3/size", "32M\n");
+    }
+    std::string node{root + "/sys/devices/system/node/"};
+    write_file(node + "online", "0-1\n");
+    write_file(node + "node0/cpulist", "0-1,4-5\n");
+    write_file(node + "node1/cpulist", "2-3,6-7\n");
+    write_file(root + "/proc/self/status", "Name:\tgtest\nCpus_allowed:\t7f\nCpus_allowed_list:\t0-6\n");
+    return root;
+}
+
+TEST(CpuTopology, parse_list)
+{
+    EXPECT_EQ((std::vector<uint16_t>{0, 1, 2, 3, 8, 10, 11}), cpu_topology::parse_list("0-3,8,10-11\n"));
+    EXPECT_EQ((std::vector<uint16_t>{5}), cpu_topology::parse_list("5"));
+    EXPECT_TRUE(cpu_topology::parse_list("").empty());
+}
+
+TEST(CpuTopology, synthetic)
+{
+    std::string  root{synthetic_topology()};
+    cpu_topology t{root};
+
+    ASSERT_EQ(8U, t.cpus().size());
+    EXPECT_EQ(4U, t.cores());
+    EXPECT_EQ(2U, t.nodes());
+
+    auto c5{t.find(5)};
+    ASSERT_NE(nullptr, c5);
+    EXPECT_EQ(1U, c5->_core);
+    EXPECT_EQ(0U, c5->_package);
+    EXPECT_EQ(0U, c5->_node);
+    EXPECT_EQ(1U, c5->_smt);
+    EXPECT_EQ(2U, c5->_siblings);
+    EXPECT_EQ(48U, c5->_l1d_kb);
+    EXPECT_EQ(2048U, c5->_l2_kb);
+    EXPECT_EQ(32U * 1024, c5->_l3_kb);
+    EXPECT_EQ(t.find(1)->_core, c5->_core);
+    EXPECT_FALSE(t.find(7)->_allowed);
+
+    // cores first, then the SMT siblings, without the not allowed cpu 7.
+    EXPECT_EQ((std::vector<uint16_t>{0, 1, 4, 5}), t.node_cpus(0));
+    EXPECT_EQ((std::vector<uint16_t>{2, 3, 6}), t.node_cpus(1));
+    EXPECT_EQ(3, t.cpu_for(1, 1));
+    EXPECT_EQ(2, t.cpu_for(1, 3));
+    EXPECT_EQ(-1, t.cpu_for(2, 0));
+
+    std::string rm{"rm -rf " + root};
+    EXPECT_EQ(0, std::system(rm.c_str()));
+}
+
+TEST(CpuTopology, this_machine)
+{
+    auto& t{es::init::cpu_topology_singleton::instance()};
+    ASSERT_FALSE(t.cpus().empty());
+    EXPECT_LE(1U, t.cores());
+    EXPECT_LE(1U, t.nodes());
+
+    int cpu{t.cpu_for(t.find(static_cast<unsigned>(sched_getcpu()))->_node, 0)};
+    ASSERT_LE(0, cpu);
+    std::thread pinned([cpu]() {
+        EXPECT_EQ(0, cpu_topology::pin_current_thread(static_cast<unsigned>(cpu)));
+        EXPECT_EQ(cpu, sched_getcpu());
+    });
+    pinned.join();
+}
+
+TEST(CpuTopology, pin_to_cpu_out_of_range)
+{
+    EXPECT_EQ(EINVAL, cpu_topology::pin_current_thread(CPU_SETSIZE + 7));
+    EXPECT_EQ(EINVAL, cpu_topology::pin_current_thread(~0U));
+}
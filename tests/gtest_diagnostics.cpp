@@ -0,0 +1,64 @@
+
+#include <singleton.h>
+
+// checked before gtest brings them in.
+#if defined(_GLIBCXX_IOSTREAM) || defined(_GLIBCXX_OSTREAM) || defined(_GLIBCXX_ISTREAM) || defined(_GLIBCXX_IOS)
+#error "singleton.h should not depend on a stream library"
+#endif
+static_assert(std::is_empty_v<es::init::default_init>, "the ios_base::Init guard is opt-in");
+//
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+static std::vector<std::string> lines;
+
+static void capture_sink(const char* line, std::size_t length) { lines.emplace_back(line, length); }
+
+struct Reported
+{
+    int _v{7};
+};
+
+TEST(Diagnostics, sink_gets_complete_lines)
+{
+    lines.clear();
+    auto previous = es::init::set_diagnostics_sink(capture_sink);
+    es::init::diagnostic{} << "n: " << -42 << " u: " << 42U << " max: " << UINT64_MAX << " p: " << (void*)0x1f << ' '
+                           << std::string_view{"sv"};
+    es::init::set_diagnostics_sink(previous);
+
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ("n: -42 u: 42 max: 18446744073709551615 p: 0x1f sv\n", lines[0]);
+}
+
+TEST(Diagnostics, long_line_is_truncated)
+{
+    lines.clear();
+    auto previous = es::init::set_diagnostics_sink(capture_sink);
+    {
+        es::init::diagnostic d;
+        for (int i = 0; i < 1000; ++i) d << 'x';
+    }
+    es::init::set_diagnostics_sink(previous);
+
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ(512U, lines[0].size());
+    EXPECT_EQ('\n', lines[0].back());
+}
+
+TEST(Diagnostics, report_singletons_stack)
+{
+    EXPECT_EQ(7, es::init::singleton<Reported>::instance()._v);
+
+    lines.clear();
+    auto previous = es::init::set_diagnostics_sink(capture_sink);
+    es::init::report_singletons_stack();
+    es::init::set_diagnostics_sink(previous);
+
+    ASSERT_EQ(es::init::stack::size(), lines.size());
+    bool found{false};
+    for (auto& l : lines) found |= l.find("Reported") != std::string::npos;
+    EXPECT_TRUE(found);
+}
@@ -0,0 +1,99 @@
+
+#include <executor.h>
+//
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+
+// a singleton using the executor, from its constructor and its destructor.
+struct Flusher
+{
+    Flusher() : _pool(es::init::executor_singleton::instance()) {}
+    ~Flusher()
+    {
+        _pool.submit([]() {
+            ::usleep(20'000);
+            es::init::diagnostic{} << "flushed by worker: " << es::init::executor_singleton::instance().worker_index();
+        });
+        es::init::diagnostic{} << "~Flusher() done";
+    }
+    es::init::executor& _pool;
+};
+using lazy_flusher = es::init::singleton<Flusher, es::init::lazy_initializer>;
+
+static long fib(es::init::executor& pool, std::atomic<long>& sum, int n)
+{
+    if (n < 2) return sum += n;
+    pool.submit([&pool, &sum, n]() { fib(pool, sum, n - 1); });
+    return fib(pool, sum, n - 2);
+}
+
+TEST(Executor, sized_from_topology)
+{
+    auto& pool{es::init::executor_singleton::instance()};
+    EXPECT_LE(1U, pool.size());
+    EXPECT_EQ(-1, pool.worker_index());
+}
+
+TEST(Executor, tasks_submit_tasks)
+{
+    es::init::executor pool{4};
+    std::atomic<long>  sum{0};
+    pool.submit([&]() { fib(pool, sum, 20); });
+    pool.wait_idle();
+    EXPECT_EQ(6765, sum.load());
+}
+
+TEST(Executor, all_workers_run_tasks)
+{
+    es::init::executor    pool{3};
+    std::atomic<unsigned> mask{0};
+    for (int i = 0; i < 300; ++i)
+        pool.submit([&]() {
+            mask |= 1U << pool.worker_index();
+            ::usleep(100);
+        });
+    pool.wait_idle();
+    EXPECT_EQ(7U, mask.load());
+}
+
+TEST(Executor, destructor_drains)
+{
+    std::atomic<int> done{0};
+    {
+        es::init::executor pool{2};
+        for (int i = 0; i < 100; ++i)
+            pool.submit([&]() {
+                ::usleep(100);
+                ++done;
+            });
+    }
+    EXPECT_EQ(100, done.load());
+}
+
+TEST(Executor, destroyed_after_its_dependents)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");  // a fresh process, not a forked child
+    EXPECT_EXIT(
+        {
+            lazy_flusher::instance();
+            std::exit(0);
+        },
+        testing::ExitedWithCode(0), "~Flusher\\(\\) done\nflushed by worker: [0-9]");
+}
+
+TEST(Executor, invalid_thread_count_falls_back)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");  // a fresh process, reads the environment
+    ::setenv("ES_INIT_EXECUTOR_THREADS", "-1", 1);
+    EXPECT_EXIT(
+        {
+            auto threads{es::init::executor_singleton::instance().size()};
+            std::exit(threads <= es::init::executor::max_threads ? 0 : 1);
+        },
+        testing::ExitedWithCode(0), "invalid ES_INIT_EXECUTOR_THREADS: '-1'");
+    ::unsetenv("ES_INIT_EXECUTOR_THREADS");
+}
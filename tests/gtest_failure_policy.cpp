@@ -0,0 +1,104 @@
+
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+// the constructor fails `fail` times, then succeeds.
+template<int N>
+struct Flaky
+{
+    Flaky()
+    {
+        ++attempts;
+        if (attempts <= fail) throw std::runtime_error("attempt " + std::to_string(attempts));
+    }
+    int value{N};
+
+    static inline int attempts{0};
+    static inline int fail{0};
+};
+
+using rethrowing = Flaky<1>;
+using backing_off = Flaky<2>;
+using cached = Flaky<3>;
+
+template<>
+struct es::init::failure_policy_traits<backing_off>
+    : es::init::failure_policy_config<es::init::failure_policy::retry_with_backoff, 20, 40>
+{
+};
+template<>
+struct es::init::failure_policy_traits<cached> : es::init::failure_policy_config<es::init::failure_policy::cache_failure>
+{
+};
+
+template<typename T>
+using lazy = es::init::singleton<T, es::init::lazy_initializer>;
+
+// the backoff clock, stepped by the test.
+static int64_t now_ns{0};
+static int64_t test_clock() noexcept { return now_ns; }
+static void    advance_ms(int64_t ms) { now_ns += ms * 1'000'000; }
+
+template<typename T>
+static std::string access_error()
+{
+    try
+    {
+        lazy<T>::instance();
+    }
+    catch (const std::exception& e)
+    {
+        return e.what();
+    }
+    return "";
+}
+
+TEST(FailurePolicy, rethrow_retries_on_every_access)
+{
+    rethrowing::fail = 2;
+    EXPECT_EQ("attempt 1", access_error<rethrowing>());
+    EXPECT_EQ("attempt 2", access_error<rethrowing>());  // not a circular dependency
+    EXPECT_EQ(1, lazy<rethrowing>::instance().value);
+    EXPECT_EQ(3, rethrowing::attempts);
+}
+
+TEST(FailurePolicy, retry_with_backoff)
+{
+    auto previous{es::init::set_backoff_clock(test_clock)};
+    backing_off::fail = 3;
+    EXPECT_EQ("attempt 1", access_error<backing_off>());
+    for (int i = 0; i < 1000; ++i) access_error<backing_off>();
+    advance_ms(19);
+    EXPECT_EQ("attempt 1", access_error<backing_off>());
+    EXPECT_EQ(1, backing_off::attempts);  // within the 20ms backoff
+
+    advance_ms(1);
+    EXPECT_EQ("attempt 2", access_error<backing_off>());
+    advance_ms(39);
+    EXPECT_EQ("attempt 2", access_error<backing_off>());  // the backoff doubled to 40ms
+
+    advance_ms(1);
+    EXPECT_EQ("attempt 3", access_error<backing_off>());
+    advance_ms(39);
+    EXPECT_EQ("attempt 3", access_error<backing_off>());  // capped at 40ms
+    advance_ms(1);
+    EXPECT_EQ(2, lazy<backing_off>::instance().value);
+    EXPECT_EQ(4, backing_off::attempts);
+    es::init::set_backoff_clock(previous);
+}
+
+TEST(FailurePolicy, cache_failure)
+{
+    cached::fail = 1;
+    auto previous{es::init::set_backoff_clock(test_clock)};
+    EXPECT_EQ("attempt 1", access_error<cached>());
+    advance_ms(3'600'000);
+    EXPECT_EQ("attempt 1", access_error<cached>());
+    EXPECT_THROW(lazy<cached>::instance(), std::runtime_error);
+    EXPECT_EQ(1, cached::attempts);
+    es::init::set_backoff_clock(previous);
+}
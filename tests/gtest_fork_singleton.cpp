@@ -0,0 +1,177 @@
+
+#include <keyed_singleton.h>
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+//
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+template<int N>
+struct Counted
+{
+    Counted() { ++constructed; }
+    ~Counted() { ++destroyed; }
+    int               _value{N};
+    static inline int constructed{0};
+    static inline int destroyed{0};
+};
+
+using Shared  = Counted<1>;
+using Reinit  = Counted<2>;
+using Dropped = Counted<3>;
+
+template<>
+struct es::init::fork_policy_traits<Reinit>
+{
+    static constexpr fork_policy value{fork_policy::reinit_in_child};
+};
+template<>
+struct es::init::fork_policy_traits<Dropped>
+{
+    static constexpr fork_policy value{fork_policy::drop_in_child};
+};
+
+// runs f() in a child process, returns its exit code
+template<typename F>
+int in_child(F&& f)
+{
+    pid_t pid = ::fork();
+    if (pid == 0)
+    {
+        ::alarm(10);
+        ::_exit(f());
+    }
+    int status{0};
+    ::waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(ForkSingleton, share)
+{
+    auto& s{es::init::singleton<Shared, es::init::lazy_initializer>::instance()};
+    s._value = 11;
+    EXPECT_EQ(0, in_child([&]() {
+                  auto& c{es::init::singleton<Shared, es::init::lazy_initializer>::instance()};
+                  return (&c == &s && c._value == 11 && Shared::constructed == 1) ? 0 : 1;
+              }));
+}
+
+TEST(ForkSingleton, reinit_in_child)
+{
+    auto& s{es::init::singleton<Reinit, es::init::lazy_initializer>::instance()};
+    s._value = 22;
+    EXPECT_EQ(0, in_child([&]() {
+                  if (Reinit::constructed != 2) return 1;  // constructed again right after fork()
+                  auto& c{es::init::singleton<Reinit, es::init::lazy_initializer>::instance()};
+                  return (c._value == 2 && Reinit::constructed == 2 && Reinit::destroyed == 0) ? 0 : 2;
+              }));
+    EXPECT_EQ(22, s._value);
+    EXPECT_EQ(1, Reinit::constructed);
+}
+
+TEST(ForkSingleton, drop_in_child)
+{
+    auto& s{es::init::singleton<Dropped, es::init::lazy_initializer>::instance()};
+    s._value = 33;
+    EXPECT_EQ(0, in_child([&]() {
+                  if (Dropped::constructed != 1) return 1;  // not constructed until accessed
+                  auto& c{es::init::singleton<Dropped, es::init::lazy_initializer>::instance()};
+                  return (c._value == 3 && Dropped::constructed == 2 && Dropped::destroyed == 0) ? 0 : 2;
+              }));
+    EXPECT_EQ(33, s._value);
+}
+
+// fork() while another thread is inside the constructor, holding the singleton's lock.
+static std::atomic<bool> in_ctor{false};
+static std::atomic<bool> release_ctor{false};
+static pid_t             parent_pid{::getpid()};
+
+struct SlowCtor
+{
+    SlowCtor()
+    {
+        if (::getpid() != parent_pid) return;
+        in_ctor = true;
+        while (!release_ctor) std::this_thread::yield();
+    }
+};
+
+TEST(ForkSingleton, stale_lock_in_child)
+{
+    std::thread t{[]() { es::init::singleton<SlowCtor, es::init::lazy_initializer>::instance(); }};
+    while (!in_ctor) std::this_thread::yield();
+
+    EXPECT_EQ(0, in_child([]() {
+                  try
+                  {
+                      es::init::singleton<SlowCtor, es::init::lazy_initializer>::instance();
+                  }
+                  catch (const std::logic_error&)
+                  {
+                      return 1;
+                  }
+                  return 0;
+              }));
+
+    release_ctor = true;
+    t.join();
+}
+
+// a reinit_in_child constructor throwing in the child, the exception does not unwind through fork().
+struct ChildFails
+{
+    ChildFails()
+    {
+        if (::getpid() != parent_pid) throw std::runtime_error("no connection in the child");
+    }
+    int _value{5};
+};
+template<>
+struct es::init::fork_policy_traits<ChildFails>
+{
+    static constexpr fork_policy value{fork_policy::reinit_in_child};
+};
+using child_fails = es::init::singleton<ChildFails, es::init::lazy_initializer>;
+
+TEST(ForkSingleton, reinit_exception_in_child)
+{
+    child_fails::instance();
+    EXPECT_EQ(0, in_child([]() {
+                  parent_pid = ::getpid();  // the next construction succeeds
+                  return child_fails::instance()._value == 5 ? 0 : 1;
+              }));
+}
+
+// fork() while another thread is constructing a key.
+static std::atomic<bool> in_keyed_ctor{false};
+static std::atomic<bool> release_keyed_ctor{false};
+
+struct SlowKeyed
+{
+    explicit SlowKeyed(int key) : _key(key)
+    {
+        if (::getpid() != parent_pid) return;
+        in_keyed_ctor = true;
+        while (!release_keyed_ctor) std::this_thread::yield();
+    }
+    int _key;
+};
+using slow_keyed = es::init::keyed_singleton<SlowKeyed, int>;
+
+TEST(ForkSingleton, keyed_construction_in_progress)
+{
+    parent_pid = ::getpid();
+    std::thread t{[]() { slow_keyed::instance(7); }};
+    while (!in_keyed_ctor) std::this_thread::yield();
+
+    EXPECT_EQ(0, in_child([]() { return slow_keyed::instance(7)._key == 7 ? 0 : 1; }));
+
+    release_keyed_ctor = true;
+    t.join();
+    EXPECT_EQ(7, slow_keyed::instance(7)._key);
+}
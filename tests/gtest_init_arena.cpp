@@ -0,0 +1,138 @@
+
+#include <init_arena.h>
+//
+#include <gtest/gtest.h>
+//
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+template<typename T>
+using arena_vector = std::vector<T, es::init::arena_allocator<T>>;
+
+// a regular singleton, constructed from an arena singleton's constructor.
+struct Dependency
+{
+    arena_vector<int> _values{1, 2, 3};
+};
+
+struct Index
+{
+    Index() : _dependency(es::init::singleton<Dependency>::instance())
+    {
+        for (int i = 0; i < 10000; ++i)
+        {
+            _ids.push_back(i);
+            _by_id.emplace(i, i * 2);
+        }
+    }
+    using map_type = std::map<int, int, std::less<>, es::init::arena_allocator<std::pair<const int, int>>>;
+
+    Dependency&       _dependency;
+    arena_vector<int> _ids;
+    map_type          _by_id;
+};
+
+struct Tag;
+struct SharedA
+{
+    arena_vector<char> _v = arena_vector<char>(1000);
+};
+struct SharedB
+{
+    arena_vector<char> _v = arena_vector<char>(2000);
+};
+
+TEST(InitArena, constructor_allocations_come_from_the_arena)
+{
+    auto& index{es::init::arena_singleton<Index>::instance()};
+    auto& arena{es::init::arena_singleton<Index>::arena()};
+
+    EXPECT_EQ(&arena, index._ids.get_allocator().arena());
+    EXPECT_TRUE(arena.owns(index._ids.data()));
+    EXPECT_TRUE(arena.owns(&*index._by_id.find(777)));
+    EXPECT_LT(10000 * sizeof(int), arena.allocated());
+    EXPECT_EQ(nullptr, es::init::current_init_arena);
+
+    // the dependency was constructed with no current arena.
+    EXPECT_EQ(nullptr, index._dependency._values.get_allocator().arena());
+    EXPECT_FALSE(arena.owns(index._dependency._values.data()));
+}
+
+using shared_a = es::init::arena_singleton<SharedA, Tag>;
+using shared_b = es::init::arena_singleton<SharedB, Tag>;
+
+TEST(InitArena, shared_arena)
+{
+    auto& a{shared_a::instance()};
+    auto& b{shared_b::instance()};
+    auto& arena{es::init::singleton<es::init::shared_init_arena<Tag>>::instance()};
+
+    EXPECT_EQ(&arena, &shared_a::arena());
+    EXPECT_EQ(&arena, &shared_b::arena());
+    EXPECT_TRUE(arena.owns(a._v.data()));
+    EXPECT_TRUE(arena.owns(b._v.data()));
+    EXPECT_EQ(3000U, arena.allocated());
+}
+
+TEST(InitArena, released_in_one_step)
+{
+    void* data{nullptr};
+    {
+        es::init::arena_holder<Index> holder;
+        data = holder.object()._ids.data();
+        unsigned char resident;
+        EXPECT_EQ(0, ::mincore(reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(data) & ~4095UL), 1, &resident));
+    }
+    unsigned char resident;
+    EXPECT_EQ(-1, ::mincore(reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(data) & ~4095UL), 1, &resident));
+    EXPECT_EQ(ENOMEM, errno);
+}
+
+struct ReleaseOnly
+{
+    ~ReleaseOnly() { ++destroyed; }
+    arena_vector<int> _v = arena_vector<int>(100);
+    static inline int destroyed{0};
+};
+template<>
+struct es::init::arena_release_only<ReleaseOnly> : std::true_type
+{
+};
+
+TEST(InitArena, release_only_skips_the_destructor)
+{
+    {
+        es::init::arena_holder<ReleaseOnly> holder;
+        EXPECT_TRUE(holder.arena().owns(holder.object()._v.data()));
+    }
+    EXPECT_EQ(0, ReleaseOnly::destroyed);
+}
+
+TEST(InitArena, heap_without_current_arena)
+{
+    arena_vector<int> v{1, 2, 3};
+    EXPECT_EQ(nullptr, v.get_allocator().arena());
+    EXPECT_EQ(6, v[0] + v[1] + v[2]);
+}
+
+struct Failing
+{
+    Failing() { throw std::runtime_error("down"); }
+};
+
+// a singleton constructor throwing in an arena scope leaves the scope's arena current.
+TEST(InitArena, scope_kept_after_a_constructor_exception)
+{
+    es::init::init_arena       arena;
+    es::init::init_arena_scope scope{arena};
+    using failing = es::init::singleton<Failing, es::init::lazy_initializer>;
+    EXPECT_THROW(failing::instance(), std::runtime_error);
+    EXPECT_EQ(&arena, es::init::current_init_arena);
+    arena_vector<int> v(10);
+    EXPECT_TRUE(arena.owns(v.data()));
+}
@@ -0,0 +1,153 @@
+
+#include <keyed_singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Feed
+{
+    explicit Feed(const std::string& venue) : _venue(venue) { ++constructed; }
+    std::string                    _venue;
+    static inline std::atomic<int> constructed{0};
+};
+using feeds = es::init::keyed_singleton<Feed, std::string>;
+
+struct Account
+{
+    Account() { ++constructed; }
+    int                            _balance{100};
+    static inline std::atomic<int> constructed{0};
+};
+using accounts = es::init::keyed_singleton<Account, int>;
+
+TEST(KeyedSingleton, one_instance_per_key)
+{
+    auto& a{feeds::instance("XNAS")};
+    auto& b{feeds::instance("XNYS")};
+    EXPECT_NE(&a, &b);
+    EXPECT_EQ(&a, &feeds::instance("XNAS"));
+    EXPECT_EQ("XNAS", a._venue);
+    EXPECT_EQ("XNYS", b._venue);
+    EXPECT_EQ(2, Feed::constructed.load());
+    EXPECT_EQ(&b, feeds::find("XNYS"));
+    EXPECT_EQ(nullptr, feeds::find("BATS"));
+    EXPECT_EQ(2U, feeds::size());
+}
+
+TEST(KeyedSingleton, constructed_once_under_concurrency)
+{
+    std::vector<std::thread> threads;
+    std::atomic<bool>        go{false};
+    std::vector<Account*>    seen(8 * 200);
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&, t]() {
+            while (!go) std::this_thread::yield();
+            for (int k = 0; k < 200; ++k) seen[t * 200 + k] = &accounts::instance(k);
+        });
+    go = true;
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(200, Account::constructed.load());
+    EXPECT_EQ(200U, accounts::size());
+    for (int t = 0; t < 8; ++t)
+        for (int k = 0; k < 200; ++k) EXPECT_EQ(seen[k], seen[t * 200 + k]);
+}
+
+struct Flaky
+{
+    explicit Flaky(int key)
+    {
+        if (++attempts < 3) throw std::runtime_error("not ready " + std::to_string(key));
+    }
+    static inline int attempts{0};
+};
+
+TEST(KeyedSingleton, throwing_constructor_is_retried)
+{
+    using flaky = es::init::keyed_singleton<Flaky, int>;
+    EXPECT_THROW(flaky::instance(1), std::runtime_error);
+    EXPECT_EQ(nullptr, flaky::find(1));
+    EXPECT_THROW(flaky::instance(1), std::runtime_error);
+    flaky::instance(1);
+    EXPECT_EQ(3, Flaky::attempts);
+}
+
+struct Offline
+{
+    explicit Offline(int key)
+    {
+        ++attempts;
+        if (key < 0) throw std::runtime_error("offline " + std::to_string(key));
+    }
+    static inline int attempts{0};
+};
+template<>
+struct es::init::failure_policy_traits<Offline> : es::init::failure_policy_config<es::init::failure_policy::cache_failure>
+{
+};
+
+TEST(KeyedSingleton, failure_cached_per_key)
+{
+    using offline = es::init::keyed_singleton<Offline, int>;
+    EXPECT_THROW(offline::instance(-1), std::runtime_error);
+    EXPECT_THROW(offline::instance(-1), std::runtime_error);
+    EXPECT_EQ(1, Offline::attempts);
+    offline::instance(1);
+    EXPECT_EQ(2, Offline::attempts);
+    EXPECT_FALSE(offline::reset(-1));
+    es::init::reset_all();
+    EXPECT_EQ(0U, offline::size());  // the entries are freed
+    EXPECT_THROW(offline::instance(-1), std::runtime_error);
+    EXPECT_EQ(3, Offline::attempts);
+}
+
+struct Cycle
+{
+    explicit Cycle(int key) { es::init::keyed_singleton<Cycle, int>::instance(key); }
+};
+
+TEST(KeyedSingleton, circular_dependency)
+{
+    using cycles = es::init::keyed_singleton<Cycle, int>;
+    EXPECT_THROW(cycles::instance(5), std::logic_error);
+}
+
+TEST(KeyedSingleton, full_table)
+{
+    using small = es::init::keyed_singleton<Account, long, std::hash<long>, 4>;
+    for (long k = 0; k < 4; ++k) small::instance(k);
+    EXPECT_THROW(small::instance(4), std::length_error);
+    EXPECT_NE(nullptr, small::find(3));
+}
+
+struct Venue
+{
+    explicit Venue(int id) : _id(id) {}
+    ~Venue() { es::init::diagnostic{} << "~Venue " << _id; }
+    int _id;
+};
+struct Registry
+{
+    ~Registry() { es::init::diagnostic{} << "~Registry"; }
+};
+using lazy_registry = es::init::singleton<Registry, es::init::lazy_initializer>;
+using venues        = es::init::keyed_singleton<Venue, int>;
+
+TEST(KeyedSingleton, destroyed_in_reverse_creation_order)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_EXIT(
+        {
+            venues::instance(1);
+            lazy_registry::instance();
+            venues::instance(2);
+            std::exit(0);
+        },
+        testing::ExitedWithCode(0), "~Venue 2\n~Registry\n~Venue 1\n");
+}
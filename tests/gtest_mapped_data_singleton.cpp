@@ -0,0 +1,126 @@
+
+#include <mapped_data_singleton.h>
+//
+#include <gtest/gtest.h>
+//
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+struct CalendarHeader
+{
+    uint64_t magic;
+    uint64_t count;
+};
+struct Holiday
+{
+    uint32_t yyyymmdd;
+    uint32_t flags;
+};
+
+struct CalendarFile
+{
+    using header_type = CalendarHeader;
+    using record_type = Holiday;
+    static constexpr const char* arg_name{"calendar"};
+    static constexpr const char* env_name{"GTEST_MAPPED_CALENDAR"};
+    static bool validate(const header_type& h, std::size_t records) { return h.magic == 0xca1e && h.count == records; }
+};
+
+struct BadCalendarFile : CalendarFile
+{
+    static constexpr const char* env_name{"GTEST_MAPPED_BAD_CALENDAR"};
+    static bool validate(const header_type& h, std::size_t) { return h.magic == 0xbad; }
+};
+
+static std::string write_calendar(unsigned n, const char* suffix = "")
+{
+    std::string    path{"/tmp/gtest_mapped_data_singleton." + std::to_string(::getpid()) + suffix};
+    FILE*          f{::fopen(path.c_str(), "w")};
+    CalendarHeader h{0xca1e, n};
+    ::fwrite(&h, sizeof(h), 1, f);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        Holiday d{20200101 + i, i};
+        ::fwrite(&d, sizeof(d), 1, f);
+    }
+    ::fclose(f);
+    return path;
+}
+
+// early initialized (the default), its file is given before the early initializers run.
+struct EarlyCalendarFile : CalendarFile
+{
+    static constexpr const char* arg_name{"early-calendar"};
+    static constexpr const char* env_name{"GTEST_MAPPED_EARLY_CALENDAR"};
+};
+
+[[using gnu: constructor(101)]] static void give_early_calendar()
+{
+    ::setenv("GTEST_MAPPED_EARLY_CALENDAR", write_calendar(3, ".early").c_str(), 1);
+}
+
+struct PrecedenceCalendarFile : CalendarFile
+{
+    static constexpr const char* arg_name{"precedence-calendar"};
+    static constexpr const char* env_name{"GTEST_MAPPED_PRECEDENCE_CALENDAR"};
+};
+
+TEST(MappedDataSingleton, early_initialized)
+{
+    auto& cal{es::init::mapped_data_singleton<EarlyCalendarFile, es::init::early_initializer>::instance()};
+    EXPECT_EQ(::getenv("GTEST_MAPPED_EARLY_CALENDAR"), cal.path());
+    EXPECT_EQ(3U, cal.size());
+    ::unlink(cal.path().c_str());
+}
+
+TEST(MappedDataSingleton, command_line_has_precedence)
+{
+    auto from_env{write_calendar(1, ".env")};
+    auto from_args{write_calendar(2, ".args")};
+    ::setenv("GTEST_MAPPED_PRECEDENCE_CALENDAR", from_env.c_str(), 1);
+
+    std::string option{"--precedence-calendar=" + from_args};
+    char*       argv[]{const_cast<char*>("gtest"), option.data(), nullptr};
+    auto        saved_argc{es::init::app_argc};
+    auto        saved_argv{es::init::app_argv};
+    es::init::app_argc = 2;
+    es::init::app_argv = argv;
+
+    auto& cal{es::init::mapped_data_singleton<PrecedenceCalendarFile>::instance()};
+    es::init::app_argc = saved_argc;
+    es::init::app_argv = saved_argv;
+    EXPECT_EQ(from_args, cal.path());
+    EXPECT_EQ(2U, cal.size());
+
+    ::unlink(from_env.c_str());
+    ::unlink(from_args.c_str());
+}
+
+TEST(MappedDataSingleton, typed_view)
+{
+    auto path{write_calendar(10)};
+    ::setenv("GTEST_MAPPED_CALENDAR", path.c_str(), 1);
+
+    auto& cal{es::init::mapped_data_singleton<CalendarFile>::instance()};
+    EXPECT_EQ(path, cal.path());
+    EXPECT_EQ(10U, cal.header().count);
+    EXPECT_EQ(10U, cal.size());
+    EXPECT_EQ(20200103U, cal[2].yyyymmdd);
+    uint32_t sum{0};
+    for (auto& d : cal) sum += d.flags;
+    EXPECT_EQ(45U, sum);
+
+    ::unlink(path.c_str());
+}
+
+TEST(MappedDataSingleton, invalid_header)
+{
+    auto path{write_calendar(1)};
+    ::setenv("GTEST_MAPPED_BAD_CALENDAR", path.c_str(), 1);
+    EXPECT_THROW((es::init::mapped_data_singleton<BadCalendarFile>::instance()),
+                 std::runtime_error);
+    ::unlink(path.c_str());
+}
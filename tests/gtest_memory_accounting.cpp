@@ -0,0 +1,87 @@
+
+#include <memory_accounting.h>
+//
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Inner
+{
+    std::vector<char> _table = std::vector<char>(64 * 1024);
+};
+using lazy_inner = es::init::singleton<Inner, es::init::lazy_initializer>;
+
+// 1MB, touched, and the Inner it depends on, constructed from its constructor.
+struct Outer
+{
+    Outer() : _buffer(new char[1024 * 1024]), _inner(lazy_inner::instance())
+    {
+        std::memset(_buffer.get(), 1, 1024 * 1024);
+    }
+    std::unique_ptr<char[]> _buffer;
+    Inner&                  _inner;
+    char                    _name[100]{};
+};
+using lazy_outer = es::init::singleton<Outer, es::init::lazy_initializer>;
+
+// a 1MB temporary, freed before the constructor returns, and a 16KB table it keeps.
+struct Parser
+{
+    Parser()
+    {
+        std::vector<char> scratch(1024 * 1024, 1);
+        _table.assign(scratch.begin(), scratch.begin() + 16 * 1024);
+    }
+    std::vector<char> _table;
+};
+using lazy_parser = es::init::singleton<Parser, es::init::lazy_initializer>;
+
+static std::vector<std::string> lines;
+static void capture(const char* line, std::size_t length) { lines.emplace_back(line, length); }
+
+TEST(MemoryAccounting, nested_constructions_are_exclusive)
+{
+    lazy_outer::instance();
+    const es::init::memory_account& outer{*lazy_outer::memory_usage()};
+    const es::init::memory_account& inner{*lazy_inner::memory_usage()};
+
+    EXPECT_EQ(sizeof(Outer), outer._object_size);
+    EXPECT_EQ(sizeof(Inner), inner._object_size);
+
+    EXPECT_LE(64U * 1024, inner._heap_bytes);
+    EXPECT_GT(64U * 1024 + 4096, inner._heap_bytes);
+    EXPECT_LE(1024U * 1024, outer._heap_bytes);
+    EXPECT_GT(1024U * 1024 + 4096, outer._heap_bytes);  // without the Inner's 64KB
+
+    EXPECT_LE(512U * 1024, outer._faulted_bytes);  // the touched buffer
+}
+
+TEST(MemoryAccounting, net_of_the_freed_bytes)
+{
+    lazy_parser::instance();
+    const es::init::memory_account& parser{*lazy_parser::memory_usage()};
+    EXPECT_LE(16U * 1024, parser._heap_bytes);
+    EXPECT_GT(16U * 1024 + 4096, parser._heap_bytes);
+}
+
+TEST(MemoryAccounting, reported)
+{
+    lazy_outer::instance();
+    auto previous{es::init::set_diagnostics_sink(capture)};
+    es::init::report_singletons_stack();
+    es::init::set_diagnostics_sink(previous);
+
+    bool found{false};
+    for (auto& line : lines)
+        if (line.find("Outer") != std::string::npos)
+        {
+            found = true;
+            EXPECT_NE(std::string::npos, line.find(" object size: " + std::to_string(sizeof(Outer)) + " heap bytes: "))
+                << line;
+            EXPECT_NE(std::string::npos, line.find(" faulted bytes: ")) << line;
+        }
+    EXPECT_TRUE(found);
+}
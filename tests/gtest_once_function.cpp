@@ -0,0 +1,63 @@
+
+#include <once_function.h>
+//
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static int              squares[256];
+static std::atomic<int> built{0};
+
+static void build_squares()
+{
+    ::usleep(10'000);  // the other first callers wait
+    for (int i = 0; i < 256; ++i) squares[i] = i * i;
+    ++built;
+}
+static int square(int i) { return squares[i & 255]; }
+
+using lazy_square = es::init::once_function<int(int), build_squares, square>;
+
+static std::atomic<int> eager_built{0};
+static void             build_eager() { ++eager_built; }
+static int              twice(int i) { return 2 * i; }
+
+using eager_twice = es::init::once_function<int(int), build_eager, twice, es::init::early_initializer>;
+
+static void recurse();
+using cyclic = es::init::once_function<void(), recurse, recurse>;
+static void recurse() { cyclic::call(); }
+
+TEST(OnceFunction, init_runs_once_under_concurrent_first_calls)
+{
+    EXPECT_FALSE(lazy_square::bound());
+    std::vector<std::thread> threads;
+    std::atomic<long>        sum{0};
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&, t]() { sum += lazy_square::call(t); });
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(1, built.load());
+    EXPECT_EQ(0 + 1 + 4 + 9 + 16 + 25 + 36 + 49, sum.load());
+    EXPECT_TRUE(lazy_square::bound());
+    EXPECT_EQ(144, lazy_square::call(12));
+    EXPECT_EQ(1, built.load());
+}
+
+TEST(OnceFunction, early_binding)
+{
+    EXPECT_TRUE(eager_twice::bound());  // before the first call
+    EXPECT_EQ(1, eager_built.load());
+    EXPECT_EQ(42, eager_twice::call(21));
+    eager_twice::bind();
+    EXPECT_EQ(1, eager_built.load());
+}
+
+TEST(OnceFunction, circular_dependency)
+{
+    EXPECT_THROW(cyclic::call(), std::logic_error);
+}
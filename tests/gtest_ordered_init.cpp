@@ -0,0 +1,117 @@
+
+#include <ordered_init.h>
+//
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+// constructed before main(), record the construction sequence in zero initialized storage.
+static unsigned constructions;
+
+template<char N>
+struct Component
+{
+    Component() : _order(constructions++) {}
+    unsigned _order;
+};
+
+using A = Component<'A'>;
+using B = Component<'B'>;
+using C = Component<'C'>;
+using D = Component<'D'>;
+using E = Component<'E'>;
+
+using es::init::depends_on;
+template<>
+struct es::init::singleton_dependencies<B>
+{
+    using type = depends_on<A>;
+};
+template<>
+struct es::init::singleton_dependencies<C>
+{
+    using type = depends_on<E, B, A>;
+};
+template<>
+struct es::init::singleton_dependencies<D>
+{
+    using type = depends_on<C, B>;
+};
+
+static_assert(std::is_same_v<es::init::init_order_t<D>, depends_on<E, A, B, C, D>>, "wrong topological order");
+static_assert(std::is_same_v<es::init::init_order_t<A, D>, depends_on<A, E, B, C, D>>, "wrong topological order");
+
+ES_INIT_ORDERED_INIT(D)
+
+TEST(OrderedInit, constructed_in_order_before_main)
+{
+    EXPECT_EQ(5U, constructions);
+    EXPECT_EQ(0U, es::init::singleton<E>::instance()._order);
+    EXPECT_EQ(1U, es::init::singleton<A>::instance()._order);
+    EXPECT_EQ(2U, es::init::singleton<B>::instance()._order);
+    EXPECT_EQ(3U, es::init::singleton<C>::instance()._order);
+    EXPECT_EQ(4U, es::init::singleton<D>::instance()._order);
+    EXPECT_EQ(5U, constructions);
+}
+
+// a dependency accessed through a lazy accessor, ordered_init<> constructs that accessor's instance.
+struct Gateway
+{
+    Gateway() { ++count; }
+    static inline unsigned count{0};
+};
+using lazy_gateway = es::init::singleton<Gateway, es::init::lazy_initializer>;
+
+struct Session
+{
+    Session() : _gateway(lazy_gateway::instance()) {}
+    Gateway& _gateway;
+};
+template<>
+struct es::init::singleton_dependencies<Session>
+{
+    using type = depends_on<lazy_gateway>;
+};
+
+static_assert(std::is_same_v<es::init::init_order_t<Session>, depends_on<lazy_gateway, Session>>,
+              "wrong topological order");
+
+[[maybe_unused]] static es::init::ordered_init<Session> session_init;
+
+TEST(OrderedInit, dependency_through_its_accessor)
+{
+    EXPECT_EQ(1U, Gateway::count);
+    EXPECT_EQ(&lazy_gateway::instance(), &es::init::singleton<Session>::instance()._gateway);
+    EXPECT_EQ(1U, Gateway::count);
+}
+
+// Hub reaches Spoke, a dependency it does not declare, and Spoke reaches back to Hub - when GTEST_ORDERED_CYCLE is set.
+// Hub is lazy, constructed by ordered_init<> only.
+struct Hub
+{
+    Hub();
+};
+using lazy_hub = es::init::singleton<Hub, es::init::lazy_initializer>;
+struct Spoke
+{
+    Spoke() { lazy_hub::instance(); }
+};
+Hub::Hub()
+{
+    static bool reached{false};  // once: a second Hub, constructed over the first one, would not reach Spoke again
+    if (::getenv("GTEST_ORDERED_CYCLE") && !reached)
+    {
+        reached = true;
+        es::init::singleton<Spoke, es::init::lazy_initializer>::instance();
+    }
+}
+
+[[maybe_unused]] static es::init::ordered_init<lazy_hub> hub_init;
+
+TEST(OrderedInit, undeclared_cycle_throws)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");  // a fresh process, ordered_init runs again before main()
+    ::setenv("GTEST_ORDERED_CYCLE", "1", 1);
+    EXPECT_DEATH(lazy_hub::instance(), "circular dependency");
+    ::unsetenv("GTEST_ORDERED_CYCLE");
+}
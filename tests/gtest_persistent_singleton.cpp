@@ -0,0 +1,135 @@
+
+#include <persistent_singleton.h>
+//
+#include <gtest/gtest.h>
+//
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+struct Index
+{
+    Index()
+    {
+        ++constructed;
+        for (unsigned i = 0; i < sizeof(_table) / sizeof(_table[0]); ++i) _table[i] = i * i;
+    }
+    uint64_t          _table[1024];
+    uint64_t          _updates{0};
+    static inline int constructed{0};
+};
+
+static const std::string snapshot_path{"/tmp/gtest_persistent_singleton." + std::to_string(::getpid())};
+
+struct SnapshotPath
+{
+    static const char* path() { return snapshot_path.c_str(); }
+};
+
+using PIndex   = es::init::persistent_singleton<Index, SnapshotPath, 1, es::init::lazy_initializer>;
+using PIndexV2 = es::init::persistent_singleton<Index, SnapshotPath, 2, es::init::lazy_initializer>;
+
+// runs f() in a child process, returns its exit code
+template<typename F>
+int in_child(F&& f)
+{
+    pid_t pid = ::fork();
+    if (pid == 0) ::_exit(f());
+    int status{0};
+    ::waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(PersistentSingleton, build_then_load)
+{
+    ::unlink(snapshot_path.c_str());
+
+    EXPECT_EQ(0, in_child([]() {
+                  auto& idx{PIndex::instance()};
+                  idx._updates = 7;
+                  return (!PIndex::loaded_from_snapshot() && Index::constructed == 1) ? 0 : 1;
+              }));
+    EXPECT_EQ(0, in_child([]() {
+                  auto& idx{PIndex::instance()};
+                  return (PIndex::loaded_from_snapshot() && Index::constructed == 0 && idx._table[10] == 100 &&
+                          idx._updates == 7)
+                             ? 0
+                             : 1;
+              }));
+    // a different version does not accept the snapshot, and rebuilds it
+    EXPECT_EQ(0, in_child([]() {
+                  auto& idx{PIndexV2::instance()};
+                  return (!PIndexV2::loaded_from_snapshot() && Index::constructed == 1 && idx._updates == 0) ? 0 : 1;
+              }));
+
+    ::unlink(snapshot_path.c_str());
+}
+
+// a process that keeps the previous snapshot mapped is not affected by another version's rebuild.
+TEST(PersistentSingleton, rebuild_keeps_the_mapped_snapshot)
+{
+    ::unlink(snapshot_path.c_str());
+    int ready[2], rebuilt[2];
+    ASSERT_EQ(0, ::pipe(ready));
+    ASSERT_EQ(0, ::pipe(rebuilt));
+
+    pid_t reader{::fork()};
+    if (reader == 0)
+    {
+        ::alarm(10);
+        auto& idx{PIndex::instance()};
+        idx._updates = 3;
+        char c{0};
+        if (::write(ready[1], &c, 1) != 1 || ::read(rebuilt[0], &c, 1) != 1) ::_exit(2);
+        idx._updates++;  // still mapped, the old file
+        ::_exit(idx._table[10] == 100 && idx._updates == 4 ? 0 : 1);
+    }
+    char c{0};
+    ASSERT_EQ(1, ::read(ready[0], &c, 1));
+    EXPECT_EQ(0, in_child([]() {
+                  auto& idx{PIndexV2::instance()};
+                  return (!PIndexV2::loaded_from_snapshot() && Index::constructed == 1 && idx._updates == 0) ? 0 : 1;
+              }));
+    ASSERT_EQ(1, ::write(rebuilt[1], &c, 1));
+    int status{0};
+    ::waitpid(reader, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // the file holds the new version's snapshot
+    EXPECT_EQ(0, in_child([]() { return PIndexV2::loaded_from_snapshot() && Index::constructed == 0 ? 0 : 1; }));
+    ::unlink(snapshot_path.c_str());
+}
+
+struct Counters
+{
+    uint64_t _starts;
+};
+
+static const char* early_path()
+{
+    static char path[64];
+    if (!path[0]) std::snprintf(path, sizeof(path), "/tmp/gtest_persistent_singleton_early.%d", int(::getpid()));
+    return path;
+}
+
+struct EarlyPath
+{
+    static const char* path() { return early_path(); }
+};
+
+// early initialized, mapped before main().
+using PCounters     = es::init::persistent_singleton<Counters, EarlyPath>;
+using PCountersLazy = es::init::persistent_singleton<Counters, EarlyPath, 0, es::init::lazy_initializer>;
+
+TEST(PersistentSingleton, early_initialized)
+{
+    EXPECT_FALSE(PCounters::loaded_from_snapshot());
+    PCounters::instance()._starts = 1;
+    PCounters::sync();
+    EXPECT_EQ(0, in_child([]() {
+                  return PCountersLazy::loaded_from_snapshot() && PCountersLazy::instance()._starts == 1 ? 0 : 1;
+              }));
+    ::unlink(early_path());
+}
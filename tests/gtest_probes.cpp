@@ -0,0 +1,130 @@
+
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+//
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Probed
+{
+    int _value{7};
+};
+using lazy_probed = es::init::singleton<Probed, es::init::lazy_initializer>;
+
+struct probe_note
+{
+    std::string _provider;
+    std::string _name;
+    std::string _args;
+    uint64_t    _pc;
+};
+
+// the .note.stapsdt notes of the test program, and the bytes of the probed instructions.
+class elf_probes
+{
+public:
+    elf_probes()
+    {
+        int fd{::open("/proc/self/exe", O_RDONLY)};
+        if (fd < 0) throw std::runtime_error("open /proc/self/exe");
+        struct stat st
+        {
+        };
+        ::fstat(fd, &st);
+        _size = static_cast<std::size_t>(st.st_size);
+        _base = static_cast<const char*>(::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0));
+        ::close(fd);
+        if (_base == MAP_FAILED) throw std::runtime_error("mmap /proc/self/exe");
+
+        auto* eh{reinterpret_cast<const Elf64_Ehdr*>(_base)};
+        _sections = reinterpret_cast<const Elf64_Shdr*>(_base + eh->e_shoff);
+        _count    = eh->e_shnum;
+        _names    = _base + _sections[eh->e_shstrndx].sh_offset;
+        if (const Elf64_Shdr* notes{section(".note.stapsdt")}) parse(*notes);
+    }
+    ~elf_probes() { ::munmap(const_cast<char*>(_base), _size); }
+
+    const Elf64_Shdr* section(const char* name) const
+    {
+        for (unsigned i = 0; i < _count; ++i)
+            if (!std::strcmp(_names + _sections[i].sh_name, name)) return &_sections[i];
+        return nullptr;
+    }
+
+    // the byte at a link time address of an executable section.
+    int byte_at(uint64_t address) const
+    {
+        for (unsigned i = 0; i < _count; ++i)
+        {
+            const Elf64_Shdr& s{_sections[i]};
+            if ((s.sh_flags & SHF_EXECINSTR) && address >= s.sh_addr && address < s.sh_addr + s.sh_size)
+                return static_cast<unsigned char>(_base[s.sh_offset + (address - s.sh_addr)]);
+        }
+        return -1;
+    }
+
+    std::vector<probe_note> _probes;
+
+private:
+    void parse(const Elf64_Shdr& notes)
+    {
+        const char* p{_base + notes.sh_offset};
+        const char* end{p + notes.sh_size};
+        auto        align4{[](std::size_t n) { return (n + 3) & ~std::size_t{3}; }};
+        while (p + sizeof(Elf64_Nhdr) <= end)
+        {
+            auto*       nh{reinterpret_cast<const Elf64_Nhdr*>(p)};
+            const char* desc{p + sizeof(Elf64_Nhdr) + align4(nh->n_namesz)};
+            if (nh->n_type == 3 && !std::strcmp(p + sizeof(Elf64_Nhdr), "stapsdt"))
+            {
+                probe_note n;
+                std::memcpy(&n._pc, desc, sizeof(n._pc));
+                const char* s{desc + 3 * sizeof(uint64_t)};
+                n._provider = s;
+                s += n._provider.size() + 1;
+                n._name = s;
+                s += n._name.size() + 1;
+                n._args = s;
+                _probes.push_back(n);
+            }
+            p = desc + align4(nh->n_descsz);
+        }
+    }
+
+    const char*       _base{nullptr};
+    std::size_t       _size{0};
+    const Elf64_Shdr* _sections{nullptr};
+    unsigned          _count{0};
+    const char*       _names{nullptr};
+};
+
+TEST(Probes, lifecycle_notes_in_the_elf)
+{
+    EXPECT_EQ(7, lazy_probed::instance()._value);  // runs through the untraced probes
+
+    elf_probes elf;
+    std::set<std::string> names;
+    for (auto& p : elf._probes)
+        if (p._provider == "es_init")
+        {
+            names.insert(p._name);
+            EXPECT_EQ(3, std::count(p._args.begin(), p._args.end(), '@')) << p._name << ": " << p._args;
+            EXPECT_EQ(0x90, elf.byte_at(p._pc)) << p._name;  // a nop when no tracer is attached
+        }
+
+    for (const char* name :
+         {"construct__begin", "construct__end", "destroy__begin", "destroy__end", "circular__dependency",
+          "lock__contention"})
+        EXPECT_EQ(1U, names.count(name)) << name;
+}
@@ -0,0 +1,128 @@
+
+#include <keyed_singleton.h>
+#include <singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+// constructed on first use, by the early initialized singletons before main(), never destroyed.
+static std::string& events()
+{
+    static std::string* e{new std::string};
+    return *e;
+}
+
+struct Clock
+{
+    Clock() { events() += "+Clock "; }
+    ~Clock() { events() += "-Clock "; }
+    long _now{0};
+};
+
+// early initialized, depends on the clock.
+struct Journal
+{
+    Journal() : _clock(es::init::singleton<Clock>::instance()) { events() += "+Journal "; }
+    ~Journal() { events() += "-Journal "; }
+    Clock& _clock;
+    int    _entries{0};
+};
+
+struct Venue
+{
+    explicit Venue(const std::string& name) : _name(name) { ++constructed; }
+    std::string       _name;
+    static inline int constructed{0};
+};
+
+struct Unreachable
+{
+    Unreachable()
+    {
+        ++attempts;
+        throw std::runtime_error("down");
+    }
+    static inline int attempts{0};
+};
+template<>
+struct es::init::failure_policy_traits<Unreachable>
+    : es::init::failure_policy_config<es::init::failure_policy::cache_failure>
+{
+};
+
+using journal     = es::init::singleton<Journal>;
+using clock_s     = es::init::singleton<Clock, es::init::lazy_initializer>;
+using venues      = es::init::keyed_singleton<Venue, std::string>;
+using unreachable = es::init::singleton<Unreachable, es::init::lazy_initializer>;
+
+TEST(Reset, reset_all_reconstructs)
+{
+    EXPECT_EQ("+Clock +Journal ", events());  // before main()
+    journal::instance()._entries = 5;
+
+    events().clear();
+    auto stacked{es::init::stack::size()};
+    es::init::reset_all();
+    EXPECT_EQ("-Journal -Clock ", events());
+    EXPECT_EQ(0U, es::init::stack::size());
+    EXPECT_LE(2U, stacked);
+
+    events().clear();
+    EXPECT_EQ(0, journal::instance()._entries);  // an early initialized singleton, constructed again on access
+    EXPECT_EQ("+Clock +Journal ", events());
+    EXPECT_EQ(2U, es::init::stack::size());
+}
+
+TEST(Reset, one_singleton)
+{
+    es::init::reset_all();
+    clock_s::instance()._now = 7;
+    journal::instance();
+    auto stacked{es::init::stack::size()};
+
+    events().clear();
+    EXPECT_TRUE(clock_s::reset());
+    EXPECT_FALSE(clock_s::reset());
+    EXPECT_EQ("-Clock ", events());
+    EXPECT_EQ(stacked - 1, es::init::stack::size());
+    EXPECT_EQ(0, clock_s::instance()._now);
+    EXPECT_EQ(stacked, es::init::stack::size());
+
+    events().clear();
+    es::init::reset_all();
+    EXPECT_EQ("-Clock -Journal -Clock ", events());  // reverse creation order
+}
+
+TEST(Reset, keyed)
+{
+    es::init::reset_all();
+    Venue::constructed = 0;
+    venues::instance("XNAS");
+    venues::instance("XNYS");
+    EXPECT_TRUE(venues::reset("XNAS"));
+    EXPECT_FALSE(venues::reset("XNAS"));
+    EXPECT_EQ(nullptr, venues::find("XNAS"));
+    EXPECT_NE(nullptr, venues::find("XNYS"));
+    EXPECT_EQ("XNAS", venues::instance("XNAS")._name);
+
+    es::init::reset_all();
+    EXPECT_EQ(nullptr, venues::find("XNYS"));
+    EXPECT_EQ("XNYS", venues::instance("XNYS")._name);
+    EXPECT_EQ(4, Venue::constructed);
+    EXPECT_EQ(2U, es::init::stack::size());  // and the venues table
+}
+
+TEST(Reset, clears_a_cached_failure)
+{
+    EXPECT_THROW(unreachable::instance(), std::runtime_error);
+    EXPECT_THROW(unreachable::instance(), std::runtime_error);
+    EXPECT_EQ(1, Unreachable::attempts);
+    EXPECT_FALSE(unreachable::reset());  // not constructed, the failure is cleared anyway
+    EXPECT_THROW(unreachable::instance(), std::runtime_error);
+    EXPECT_EQ(2, Unreachable::attempts);
+    es::init::reset_all();
+    EXPECT_THROW(unreachable::instance(), std::runtime_error);
+    EXPECT_EQ(3, Unreachable::attempts);
+}
@@ -0,0 +1,130 @@
+
+#include <scoped_singleton.h>
+//
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Session;
+struct Other;
+
+static std::string events;
+
+struct Config
+{
+    Config() { events += "+Config "; }
+    ~Config() { events += "-Config "; }
+    int _depth{3};
+};
+
+// constructed after, destroyed before, its dependency.
+struct Book
+{
+    Book() : _config(es::init::scoped_singleton<Config, Session>::instance()) { events += "+Book "; }
+    ~Book()
+    {
+        events += "-Book(" + std::to_string(_config._depth) + ") ";
+        es::init::scoped_singleton<Config, Session>::instance();  // still constructed, not a new one
+    }
+    Config&                                          _config;
+    std::vector<int, es::init::arena_allocator<int>> _levels = std::vector<int, es::init::arena_allocator<int>>(100);
+};
+
+struct Loop;
+struct LoopBack
+{
+    LoopBack();
+};
+struct Loop
+{
+    Loop() { es::init::scoped_singleton<LoopBack, Session>::instance(); }
+};
+LoopBack::LoopBack() { es::init::scoped_singleton<Loop, Session>::instance(); }
+
+using config       = es::init::scoped_singleton<Config, Session>;
+using book         = es::init::scoped_singleton<Book, Session>;
+using other_config = es::init::scoped_singleton<Config, Other>;
+using loop         = es::init::scoped_singleton<Loop, Session>;
+
+TEST(ScopedSingleton, one_instance_per_scope)
+{
+    es::init::singleton_scope<Session> a;
+    es::init::singleton_scope<Session> b;
+    Config*                            in_a{nullptr};
+    {
+        es::init::scope_guard<Session> current{a};
+        in_a = &config::instance();
+        EXPECT_EQ(in_a, &config::instance());
+        EXPECT_EQ(&a, es::init::singleton_scope<Session>::current());
+        {
+            es::init::scope_guard<Session> nested{b};
+            EXPECT_NE(in_a, &config::instance());
+            EXPECT_EQ(1U, b.size());
+        }
+        EXPECT_EQ(in_a, &config::instance());
+    }
+    EXPECT_EQ(nullptr, es::init::singleton_scope<Session>::current());
+    EXPECT_TRUE(a.arena().owns(in_a));
+    EXPECT_FALSE(b.arena().owns(in_a));
+}
+
+TEST(ScopedSingleton, reverse_order_teardown)
+{
+    events.clear();
+    {
+        es::init::singleton_scope<Session> scope;
+        es::init::scope_guard<Session>     current{scope};
+        Book&                              b{book::instance()};
+        EXPECT_EQ(2U, scope.size());
+        EXPECT_TRUE(scope.arena().owns(b._levels.data()));
+        EXPECT_EQ(&config::instance(), &b._config);
+    }
+    EXPECT_EQ("+Config +Book -Book(3) -Config ", events);
+}
+
+TEST(ScopedSingleton, scopes_are_independent_per_tag)
+{
+    es::init::singleton_scope<Session> session;
+    es::init::scope_guard<Session>     current{session};
+    EXPECT_THROW(other_config::instance(), std::logic_error);
+    EXPECT_NO_THROW(config::instance());
+}
+
+TEST(ScopedSingleton, circular_dependency)
+{
+    es::init::singleton_scope<Session> scope;
+    es::init::scope_guard<Session>     current{scope};
+    EXPECT_THROW(loop::instance(), std::logic_error);
+    EXPECT_EQ(0U, scope.size());
+}
+
+TEST(ScopedSingleton, threads_share_the_scope)
+{
+    es::init::singleton_scope<Session> scope;
+    std::vector<Config*>               seen(4);
+    std::vector<std::thread>           threads;
+    for (auto& p : seen)
+        threads.emplace_back([&scope, &p]() {
+            es::init::scope_guard<Session> current{scope};
+            p = &config::instance();
+        });
+    for (auto& t : threads) t.join();
+    for (auto p : seen) EXPECT_EQ(seen[0], p);
+    EXPECT_EQ(1U, scope.size());
+}
+
+TEST(ScopedSingleton, many_scopes)
+{
+    auto start{std::chrono::steady_clock::now()};
+    for (int i = 0; i < 1000; ++i)
+    {
+        es::init::singleton_scope<Session> scope;
+        es::init::scope_guard<Session>     current{scope};
+        book::instance();
+    }
+    EXPECT_GT(std::chrono::seconds(1), std::chrono::steady_clock::now() - start);
+}
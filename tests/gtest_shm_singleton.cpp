@@ -0,0 +1,168 @@
+
+#include <shm_singleton.h>
+//
+#include <gtest/gtest.h>
+//
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+struct Sequencer
+{
+    Sequencer()
+    {
+        ++_constructions;  // the zero filled segment - counts constructions across processes
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));  // let the other processes wait
+    }
+    std::atomic<uint64_t> _next;
+    std::atomic<uint32_t> _constructions;
+    std::atomic<uint32_t> _done;
+};
+
+static const std::string shm_name{"/gtest_shm_singleton." + std::to_string(::getpid())};
+
+struct SequencerName
+{
+    static const char* name() { return shm_name.c_str(); }
+};
+
+using SharedSequencer = es::init::shm_singleton<Sequencer, SequencerName, 0, es::init::lazy_initializer>;
+
+constexpr unsigned processes{4};
+constexpr unsigned loops{1000};
+
+TEST(ShmSingleton, multi_process)
+{
+    pid_t pids[processes];
+    for (auto& pid : pids)
+        if ((pid = ::fork()) == 0)
+        {
+            ::alarm(10);
+            auto& seq{SharedSequencer::instance()};
+            for (unsigned i = 0; i < loops; ++i) seq._next++;
+            ++seq._done;
+            while (seq._done < processes) std::this_thread::yield();  // keep the segment alive for all
+            std::exit(seq._constructions == 1 && seq._next == processes * loops ? 0 : 1);
+        }
+
+    for (auto pid : pids)
+    {
+        int status{0};
+        ::waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    // the last process detached, and unlinked the segment
+    int fd{::shm_open(shm_name.c_str(), O_RDONLY, 0)};
+    EXPECT_EQ(-1, fd);
+    if (fd >= 0) ::shm_unlink(shm_name.c_str());
+}
+
+static const pid_t test_pid{::getpid()};
+static int         constructing_pipe[2];
+
+// a forked child stalls in the constructor, until it is killed.
+struct Stalling
+{
+    Stalling()
+    {
+        ++_constructions;
+        if (::getpid() == test_pid) return;
+        char c{'c'};
+        (void)!::write(constructing_pipe[1], &c, 1);
+        for (;;) ::pause();
+    }
+    std::atomic<uint32_t> _constructions;
+};
+
+static const std::string stalling_name{"/gtest_shm_stalling." + std::to_string(test_pid)};
+
+struct StallingName
+{
+    static const char* name() { return stalling_name.c_str(); }
+};
+
+using SharedStalling = es::init::shm_singleton<Stalling, StallingName, 0, es::init::lazy_initializer>;
+
+// before forked_child_attaches attaches the sequencer, the killed child would keep its reference to it.
+TEST(ShmSingleton, constructor_killed)
+{
+    ASSERT_EQ(0, ::pipe(constructing_pipe));
+    pid_t pid{::fork()};
+    if (pid == 0)
+    {
+        ::alarm(10);
+        SharedStalling::instance();
+        std::exit(1);
+    }
+    char c{0};
+    ASSERT_EQ(1, ::read(constructing_pipe[0], &c, 1));  // the child is in the constructor
+
+    std::thread killer{[pid]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));  // the parent waits for the child
+        ::kill(pid, SIGKILL);
+        int status{0};
+        ::waitpid(pid, &status, 0);
+    }};
+    auto& stalling{SharedStalling::instance()};  // takes over the construction
+    killer.join();
+    EXPECT_EQ(1U, stalling._constructions);  // cleared, the child's construction is gone
+    EXPECT_EQ(1U, SharedStalling::attached());  // the child's reference was dropped
+}
+
+TEST(ShmSingleton, forked_child_attaches)
+{
+    auto& seq{SharedSequencer::instance()};
+    EXPECT_EQ(1U, SharedSequencer::attached());
+
+    pid_t pid{::fork()};
+    if (pid == 0)
+    {
+        auto& child_seq{SharedSequencer::instance()};
+        child_seq._next += 5;
+        std::exit(SharedSequencer::attached() == 2 ? 0 : 1);  // exit() - detaches
+    }
+    int status{0};
+    ::waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_EQ(5U, seq._next);
+    EXPECT_EQ(1U, SharedSequencer::attached());
+}
+
+struct Wide
+{
+    char _bytes[8192];
+};
+
+static const std::string wide_name{"/gtest_shm_wide." + std::to_string(test_pid)};
+
+struct WideName
+{
+    static const char* name() { return wide_name.c_str(); }
+};
+
+TEST(ShmSingleton, segment_size_mismatch)
+{
+    int fd{::shm_open(WideName::name(), O_RDWR | O_CREAT, 0600)};  // created by another T
+    ASSERT_LE(0, fd);
+    ASSERT_EQ(0, ::ftruncate(fd, 4096));
+    ::close(fd);
+
+    using wide = es::init::shm_singleton<Wide, WideName, 0, es::init::lazy_initializer>;
+    EXPECT_THROW(wide::instance(), std::runtime_error);
+
+    fd = ::shm_open(WideName::name(), O_RDONLY, 0);
+    struct stat st{};
+    EXPECT_EQ(0, ::fstat(fd, &st));
+    EXPECT_EQ(4096, st.st_size);  // not resized
+    ::close(fd);
+    ::shm_unlink(WideName::name());
+}
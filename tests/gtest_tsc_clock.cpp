@@ -0,0 +1,46 @@
+
+#include <tsc_clock.h>
+//
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+TEST(TscClock, calibrated_before_main)
+{
+    auto& clock{es::init::tsc_clock_singleton::instance()};
+    EXPECT_EQ(es::init::tsc_clock::invariant_tsc(), clock.uses_tsc());
+    if (clock.uses_tsc())
+    {
+        EXPECT_LT(100'000'000U, clock.ticks_per_second());
+    }
+}
+
+TEST(TscClock, monotonic)
+{
+    auto&   clock{es::init::tsc_clock_singleton::instance()};
+    int64_t prev{clock.now_ns()};
+    for (int i = 0; i < 1'000'000; ++i)
+    {
+        int64_t now{clock.now_ns()};
+        ASSERT_LE(prev, now);
+        prev = now;
+    }
+}
+
+TEST(TscClock, follows_clock_monotonic)
+{
+    const auto&               clock{es::init::tsc_clock_singleton::instance()};
+    const es::init::tsc_clock fallback{false};
+
+    for (auto* c : {&clock, &fallback})
+    {
+        int64_t tsc_start{c->now_ns()}, mono_start{es::init::monotonic_ns()};
+        EXPECT_GT(1'000'000, std::abs(tsc_start - mono_start));
+
+        timespec pause{0, 50'000'000};
+        ::nanosleep(&pause, nullptr);
+
+        int64_t tsc_elapsed{c->now_ns() - tsc_start}, mono_elapsed{es::init::monotonic_ns() - mono_start};
+        EXPECT_GT(mono_elapsed / 100, std::abs(tsc_elapsed - mono_elapsed));  // within 1%
+    }
+}
@@ -0,0 +1,158 @@
+//
+// tsc_clock - CLOCK_MONOTONIC nanoseconds from the time stamp counter, calibrated once, on first use.
+//
+// The singleton checks the invariant TSC CPUID bit, and measures the TSC frequency against
+// clock_gettime(CLOCK_MONOTONIC) over calibration_ns. now_ns() is then one rdtsc and a multiply-shift, inlined in
+// the caller. Without an invariant TSC (or not on x86-64), now_ns() calls clock_gettime().
+//
+// auto& clock{es::init::tsc_clock_singleton::instance()};  // keep the reference, its calls are inlined
+// int64_t start{clock.now_ns()};
+//
+// tsc_clock_singleton is lazy: the calibration sleep is paid by the first instance() call, not before main() by every
+// program including this header. es::init::singleton<es::init::tsc_clock> opts in to calibrating at early init.
+//
+// The frequency is not re-calibrated, a long running process drifts from CLOCK_MONOTONIC by the calibration error,
+// and does not follow NTP frequency adjustments.
+//
+// MIT License
+//
+// Copyright (c) 2019,2020 Erez Strauss, erez@erezstrauss.com
+//  http://github.com/erez-strauss/init_singleton/
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <singleton.h>
+#include <time.h>
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace es::init {
+
+class tsc_clock
+{
+public:
+    static constexpr int64_t  calibration_ns{5'000'000};
+    static constexpr unsigned shift{32};
+
+    tsc_clock() : tsc_clock(invariant_tsc()) {}
+
+    // use_tsc == false - the clock_gettime() fall back, for comparison.
+    explicit tsc_clock(bool use_tsc)
+    {
+        _base = take_sample();
+        if (!use_tsc) return;
+
+        timespec pause{0, calibration_ns};
+        while (::nanosleep(&pause, &pause) != 0)
+            ;
+        sample end{take_sample()};
+
+        int64_t ticks{static_cast<int64_t>(end._tsc - _base._tsc)};
+        int64_t ns{end._ns - _base._ns};
+        if (ticks <= 0 || ns <= 0) return;
+
+        _mult             = static_cast<uint64_t>((static_cast<uint128_t>(ns) << shift) / static_cast<uint64_t>(ticks));
+        _ticks_per_second = static_cast<uint64_t>(static_cast<uint128_t>(ticks) * 1'000'000'000 / ns);
+        _base             = end;
+        _use_tsc          = true;
+    }
+
+    [[using gnu: hot, always_inline]] int64_t now_ns() const noexcept
+    {
+        if (__builtin_expect(_use_tsc, 1)) return to_ns(ticks());
+        return monotonic_ns();
+    }
+
+    // the TSC value, zero without TSC support.
+    [[using gnu: always_inline]] static uint64_t ticks() noexcept
+    {
+#if defined(__x86_64__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // ticks() value to CLOCK_MONOTONIC nanoseconds.
+    int64_t to_ns(uint64_t tsc) const noexcept
+    {
+        __extension__ using int128_t = __int128;
+        int64_t delta{static_cast<int64_t>(tsc - _base._tsc)};  // signed, an unsynchronized core may lag a little
+        return _base._ns + static_cast<int64_t>((static_cast<int128_t>(delta) * _mult) >> shift);
+    }
+
+    bool     uses_tsc() const noexcept { return _use_tsc; }
+    uint64_t ticks_per_second() const noexcept { return _ticks_per_second; }
+
+    // CPUID.80000007H:EDX[8] - the TSC rate is constant in all ACPI P-, C- and T-states.
+    static bool invariant_tsc() noexcept
+    {
+#if defined(__x86_64__)
+        unsigned a{0}, b{0}, c{0}, d{0};
+        if (!__get_cpuid(0x80000000U, &a, &b, &c, &d) || a < 0x80000007U) return false;
+        if (!__get_cpuid(0x80000007U, &a, &b, &c, &d)) return false;
+        return (d & (1U << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct sample
+    {
+        uint64_t _tsc;
+        int64_t  _ns;
+    };
+
+    // the clock_gettime() reading with the tightest pair of TSC readings around it.
+    static sample take_sample() noexcept
+    {
+        sample   best{ticks(), monotonic_ns()};
+        uint64_t best_window{~0ULL};
+        for (int i = 0; i < 16; ++i)
+        {
+            uint64_t before{ticks()};
+            int64_t  ns{monotonic_ns()};
+            uint64_t after{ticks()};
+            if (after - before < best_window)
+            {
+                best_window = after - before;
+                best        = sample{before + best_window / 2, ns};
+            }
+        }
+        return best;
+    }
+
+    sample   _base{0, 0};
+    uint64_t _mult{0};  // nanoseconds per tick, fixed point, shift bits of fraction
+    uint64_t _ticks_per_second{0};
+    bool     _use_tsc{false};
+};
+
+using tsc_clock_singleton = singleton<tsc_clock, lazy_initializer>;
+
+}  // namespace es::init